@@ -1,5 +1,10 @@
 include "premake/extensions.lua"
 
+newoption {
+	trigger = "64-bit-entities",
+	description = "Use 64 bit ECS entities with a 32 bit index and generation"
+}
+
 workspace "LMLE"
 	location "."
 	startproject "Game"
@@ -11,6 +16,11 @@ workspace "LMLE"
 		"Retail"
 	}
 
+	-- premake5 --64-bit-entities vs2019
+	filter "options:64-bit-entities"
+		defines { "USE_64_BIT_ENTITIES" }
+	filter {}
+
 outputdir = "%{cfg.buildcfg}-%{cfg.system}-%{cfg.architecture}"
 vulkan_sdk = os.getenv("VULKAN_SDK") or "D:/SDK/Vulkan SDK 1-3-216-0"
 
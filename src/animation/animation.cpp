@@ -4,64 +4,76 @@
 
 using namespace Game;
 
+static constexpr uint32_t MAX_CURSOR_STEPS = 4;
+
 Animation::Animation(std::string_view name)
 		: m_name(std::move(name))
 		, m_numFrames(0)
 		, m_duration(0.f) {}
 
-void Animation::add_frame(const std::string& name, float time, Math::Vector3 position,
-		Math::Quaternion rotation, Math::Vector3 scale) {
-	auto& channel = m_channels[name];
-
-	channel.push_back({time, Math::BoneTransform{std::move(position), std::move(rotation),
-			std::move(scale)}});
-
-	std::sort(channel.begin(), channel.end(), [](auto& a, auto& b) {
+void Animation::add_channel(const std::string& name, std::vector<Keyframe> keyframes) {
+	std::sort(keyframes.begin(), keyframes.end(), [](auto& a, auto& b) {
 		return a.time < b.time;
 	});
 
-	if (m_numFrames < channel.size()) {
-		m_numFrames = channel.size();
+	m_channelIndices.emplace(name, static_cast<uint32_t>(m_channels.size()));
+	m_channels.push_back({static_cast<uint32_t>(m_times.size()),
+			static_cast<uint32_t>(keyframes.size())});
+
+	for (auto& keyframe : keyframes) {
+		m_times.push_back(keyframe.time);
+		m_positions.push_back(keyframe.transform.position);
+		m_rotations.push_back(keyframe.transform.rotation);
+		m_scales.push_back(keyframe.transform.scale);
 	}
 
-	if (m_duration < time) {
-		m_duration = time;
+	if (m_numFrames < keyframes.size()) {
+		m_numFrames = keyframes.size();
 	}
+
+	if (!keyframes.empty() && m_duration < keyframes.back().time) {
+		m_duration = keyframes.back().time;
+	}
+}
+
+uint32_t Animation::find_channel(const std::string& name) const {
+	auto it = m_channelIndices.find(name);
+	return it != m_channelIndices.end() ? it->second : INVALID_CHANNEL;
 }
 
-void Animation::get_transform(const std::string& name, float time, Math::BoneTransform& result) const {
-	auto& channel = m_channels.find(name)->second;
+void Animation::get_transform(uint32_t channelIndex, float time, uint32_t& cursor,
+		Math::BoneTransform& result) const {
+	auto& channel = m_channels[channelIndex];
 
-	if (channel.size() == 1) {
-		result = channel[0].transform;
+	if (channel.numKeys == 0) {
+		return;
 	}
-	else {
-		auto begin = channel.begin();
-		auto end = channel.end();
-
-		BoneKeyframe target;
-		target.time = time;
-
-		auto it = std::lower_bound(begin, end, target, [](auto& a, auto& b) {
-			return a.time < b.time;
-		});
-
-		if (it == begin) {
-			auto& frame0 = channel[0];
-			auto& frame1 = channel[1];
-			auto lerpAmt = (time - frame0.time) / (frame1.time - frame0.time);
-			frame0.transform.mix(frame1.transform, lerpAmt, result);
-		}
-		else if (it == end) {
-			result = channel.back().transform;
-		}
-		else {
-			auto& frame0 = *(it - 1);
-			auto& frame1 = *it;
-			auto lerpAmt = (time - frame0.time) / (frame1.time - frame0.time);
-			frame0.transform.mix(frame1.transform, lerpAmt, result);
-		}
+
+	const auto getKeyframe = [&](uint32_t key) {
+		return Math::BoneTransform{m_positions[key], m_rotations[key], m_scales[key]};
+	};
+
+	const uint32_t firstKey = channel.firstKey;
+	const uint32_t lastKey = firstKey + channel.numKeys - 1;
+
+	if (channel.numKeys == 1) {
+		result = getKeyframe(firstKey);
+		return;
 	}
+
+	cursor = find_key(channel, time, cursor);
+	auto key = firstKey + cursor;
+
+	if (key == firstKey) {
+		++key;
+	}
+	else if (key > lastKey) {
+		result = getKeyframe(lastKey);
+		return;
+	}
+
+	auto lerpAmt = (time - m_times[key - 1]) / (m_times[key] - m_times[key - 1]);
+	getKeyframe(key - 1).mix(getKeyframe(key), lerpAmt, result);
 }
 
 size_t Animation::get_num_frames() const {
@@ -92,3 +104,23 @@ const std::string& Animation::get_name() const {
 	return m_name;
 }
 
+// Index within the channel of the first keyframe at or after time. Steps forward from the cursor
+// a few keyframes before falling back to a binary search, which seeks and loops need.
+uint32_t Animation::find_key(const Channel& channel, float time, uint32_t cursor) const {
+	auto* times = m_times.data() + channel.firstKey;
+
+	if (cursor > channel.numKeys || (cursor > 0 && !(times[cursor - 1] < time))) {
+		auto end = cursor <= channel.numKeys ? times + cursor - 1 : times + channel.numKeys;
+		return static_cast<uint32_t>(std::lower_bound(times, end, time) - times);
+	}
+
+	for (uint32_t i = 0; i < MAX_CURSOR_STEPS; ++i, ++cursor) {
+		if (cursor == channel.numKeys || !(times[cursor] < time)) {
+			return cursor;
+		}
+	}
+
+	return static_cast<uint32_t>(std::lower_bound(times + cursor, times + channel.numKeys, time)
+			- times);
+}
+
@@ -11,30 +11,51 @@
 
 namespace Game {
 
+// Keyframes of every channel are stored back to back in separate time, position, rotation and
+// scale arrays. Channels are looked up by name once and sampled by index.
 class Animation {
 	public:
+		static constexpr uint32_t INVALID_CHANNEL = ~uint32_t{0};
+
+		struct Keyframe {
+			float time;
+			Math::BoneTransform transform;
+		};
+
 		explicit Animation(std::string_view name);
 
-		void add_frame(const std::string& name, float time, Math::Vector3 position,
-				Math::Quaternion rotation, Math::Vector3 scale);
-		
-		void get_transform(const std::string& name, float time, Math::BoneTransform& result) const;
+		// Adds every keyframe of a channel at once, sorting them by time. Each channel name is
+		// added once.
+		void add_channel(const std::string& name, std::vector<Keyframe> keyframes);
+
+		uint32_t find_channel(const std::string& name) const;
+
+		// cursor remembers where the last sample of the channel was, so playing forward finds
+		// the keyframes in constant time. It starts at 0 and is kept by the caller per channel.
+		void get_transform(uint32_t channel, float time, uint32_t& cursor,
+				Math::BoneTransform& result) const;
 
 		size_t get_num_frames() const;
 		float get_duration() const;
 
 		const std::string& get_name() const;
 	private:
-		struct BoneKeyframe {
-			float time;
-			Math::BoneTransform transform;
+		struct Channel {
+			uint32_t firstKey;
+			uint32_t numKeys;
 		};
-		
+
 		std::string m_name;
-		std::unordered_map<std::string, std::vector<BoneKeyframe>> m_channels;
+		std::unordered_map<std::string, uint32_t> m_channelIndices;
+		std::vector<Channel> m_channels;
+		std::vector<float> m_times;
+		std::vector<Math::Vector3> m_positions;
+		std::vector<Math::Quaternion> m_rotations;
+		std::vector<Math::Vector3> m_scales;
 		size_t m_numFrames;
 		float m_duration;
+
+		uint32_t find_key(const Channel&, float time, uint32_t cursor) const;
 };
 
 }
-
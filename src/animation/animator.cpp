@@ -9,6 +9,7 @@
 
 #include <core/instance.hpp>
 #include <core/instance_utils.hpp>
+#include <core/hierarchy_cache.hpp>
 #include <core/model.hpp>
 #include <animation/bone_attachment.hpp>
 
@@ -24,45 +25,78 @@ void Animator::create(ECS::Manager& ecs, ECS::Entity entity) {
 		const Animation& anim, float time, uint32_t boneIndex, Bone& bone,
 		const Math::Matrix4x4& parentTransform);*/
 
+static void bind_channels(const ECS::Manager& ecs, const HierarchyCache& cache,
+		Animator& animator, const Instance& instPrimaryPart);
+
+// Each animator only writes the bones below its own model, so animators are updated in parallel.
+// Jobs only read other components through the const manager, and fetch the hierarchy cache
+// up front as get_context may create it.
 void Game::update_animators(ECS::Manager& ecs, float deltaTime) {
-	ecs.run_system<Instance, Animator>([&](auto, auto& inst, auto& animator) {
+	const auto& cache = ecs.get_context<HierarchyCache>();
+	const auto generation = cache.get_name_generation();
+	const ECS::Manager& reader = ecs;
+
+	ecs.get_view<Instance, Animator>().par_for_each([&](auto, auto& inst, auto& animator) {
 		if (inst.m_parent == ECS::INVALID_ENTITY) {
 			return;
 		}
 
-		auto& parent = ecs.get_component<Instance>(inst.m_parent);
+		auto& parent = reader.get_component<Instance>(inst.m_parent);
 
 		if (parent.m_classID != InstanceClass::MODEL) {
 			return;
 		}
 
-		auto& model = ecs.get_component<Model>(inst.m_parent);
+		auto& model = reader.get_component<Model>(inst.m_parent);
 
 		if (model.get_primary_part() == ECS::INVALID_ENTITY) {
 			return;
 		}
 
-		auto& instPrimaryPart = ecs.get_component<Instance>(model.get_primary_part());
+		auto& instPrimaryPart = reader.get_component<Instance>(model.get_primary_part());
 
 		if (animator.m_currentAnim) {
 			auto& anim = *animator.m_currentAnim;
 
 			animator.m_animTime += deltaTime;
 
-			for_each_descendant(ecs, instPrimaryPart, [&](auto descEntity, auto& desc) {
-				if (desc.m_classID == InstanceClass::BONE) {
-					auto& ba = ecs.get_component<BoneAttachment>(descEntity);
-					Math::BoneTransform res{};
-					anim.get_transform(desc.m_name, animator.m_animTime, res);
-					ba.set_transform(ecs, desc,
-							ba.get_local_transform().fast_inverse() * res.to_transform());
-				}
-			});
+			if (animator.m_boundAnim != animator.m_currentAnim
+					|| animator.m_bindingGeneration != generation
+					|| animator.m_boundPrimaryPart != model.get_primary_part()) {
+				bind_channels(reader, cache, animator, instPrimaryPart);
+				animator.m_bindingGeneration = generation;
+				animator.m_boundPrimaryPart = model.get_primary_part();
+			}
+
+			// Only stamps the changed ticks of this animator's own bones
+			for (auto& binding : animator.m_bindings) {
+				auto& ba = ecs.get_component_mut<BoneAttachment>(binding.bone);
+				Math::BoneTransform res{};
+				anim.get_transform(binding.channel, animator.m_animTime, binding.cursor, res);
+				ba.set_transform(ba.get_local_transform().fast_inverse() * res.to_transform());
+			}
 
 			if (animator.m_animTime >= anim.get_duration()) {
 				animator.m_animTime -= anim.get_duration();
 			}
 		}
+	}, 1);
+}
+
+// Bones without a channel in the animation are left as they are
+static void bind_channels(const ECS::Manager& ecs, const HierarchyCache& cache,
+		Animator& animator, const Instance& instPrimaryPart) {
+	auto& anim = *animator.m_currentAnim;
+
+	animator.m_bindings.clear();
+	animator.m_boundAnim = animator.m_currentAnim;
+
+	for_each_descendant_of_class(ecs, cache, instPrimaryPart, InstanceClass::BONE,
+			[&](auto descEntity, auto& desc) {
+		if (auto channel = anim.find_channel(desc.m_name.get_string());
+				channel != Animation::INVALID_CHANNEL) {
+			animator.m_bindings.push_back({descEntity, channel, 0});
+		}
 	});
 }
 
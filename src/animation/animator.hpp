@@ -1,5 +1,9 @@
 #pragma once
 
+#include <cstdint>
+
+#include <vector>
+
 #include <core/memory.hpp>
 
 #include <ecs/ecs_fwd.hpp>
@@ -9,13 +13,26 @@ namespace Game {
 class Animation;
 
 struct Animator {
+	// A bone below the primary part and the channel of the current animation that moves it
+	struct ChannelBinding {
+		ECS::Entity bone;
+		uint32_t channel;
+		// Keyframe cursor of the channel, see Animation::get_transform
+		uint32_t cursor;
+	};
+
 	static void create(ECS::Manager&, ECS::Entity);
 
 	Memory::SharedPtr<Animation> m_currentAnim;
 	float m_animTime;
+
+	// Resolved by name when the animation, primary part, hierarchy or a name changes
+	std::vector<ChannelBinding> m_bindings;
+	Memory::SharedPtr<Animation> m_boundAnim;
+	uint64_t m_bindingGeneration = 0;
+	ECS::Entity m_boundPrimaryPart = ECS::INVALID_ENTITY;
 };
 
 void update_animators(ECS::Manager&, float deltaTime);
 
 }
-
@@ -1,30 +1,46 @@
 #pragma once
 
+#include <cstdint>
+
 #include <ecs/ecs_fwd.hpp>
 
+#include <core/instance_class.hpp>
+
 #include <math/transform.hpp>
 
 namespace Game {
 
 struct Instance;
 
+// Setters only mark the world transform dirty, it is recomputed by update_world_transforms
 class Attachment {
 	public:
 		static void create(ECS::Manager&, ECS::Entity);
 		static void on_ancestry_changed(ECS::Manager&, Instance&, ECS::Entity, Instance*,
 				ECS::Entity);
 
-		void set_local_transform(ECS::Manager&, Instance& selfInstance, Math::Transform);
+		// Recomputes the world transforms of every dirty attachment and the attachments below
+		// it, parents before children. Called once per frame, rebuilds the hierarchy cache if it
+		// is stale.
+		static void update_world_transforms(ECS::Manager&);
+
+		void set_local_transform(Math::Transform);
+		// Has the world transform recomputed by the next update_world_transforms
+		void mark_world_dirty();
 
 		const Math::Transform& get_local_transform() const;
 		const Math::Transform& get_world_transform() const;
 	private:
 		Math::Transform m_localTransform = Math::Transform(1.f);
-		Math::Transform m_worldTransform;
+		Math::Transform m_worldTransform = Math::Transform(1.f);
+		bool m_worldDirty = true;
 
-		void recalc_world_transform(ECS::Manager&, Instance&);
+		// Placed by the transform of a geometry ancestor or by the parent attachment
+		void recalc_world_transform(const Math::Transform& parentTransform);
+		void recalc_world_transform(const Attachment& parent);
 
-		static void update_descendant_world_transforms(ECS::Manager&, Instance&, const Attachment&);
+		template <typename, InstanceClass>
+		friend void update_attachment_world_transforms(ECS::Manager&);
 };
 
 }
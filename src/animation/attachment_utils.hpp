@@ -0,0 +1,94 @@
+#pragma once
+
+#include <ecs/ecs.hpp>
+
+#include <core/instance.hpp>
+#include <core/hierarchy_cache.hpp>
+#include <core/geom.hpp>
+#include <core/mesh_geom.hpp>
+
+#include <algorithm>
+#include <span>
+#include <vector>
+
+namespace Game {
+
+// Scratch memory of the attachment passes, kept in the manager's context so it is only allocated
+// until it reaches its high water mark
+struct AttachmentUpdateScratch {
+	std::vector<uint32_t> dirtyPositions;
+};
+
+// Recomputes the world transforms of every dirty Attachment_T and the ones of its class below it,
+// parents before children. Each is placed by its nearest geometry or classID ancestor, which comes
+// first in pre-order, so the world transform of the ancestor is already up to date.
+template <typename Attachment_T, InstanceClass classID>
+void update_attachment_world_transforms(ECS::Manager& ecs) {
+	auto& cache = ecs.get_context<HierarchyCache>();
+	cache.update(ecs);
+
+	auto recalc = [&](Attachment_T& at, uint32_t position) {
+		for (auto ancPosition = cache.get_node(position).parentPosition;
+				ancPosition != HierarchyCache::INVALID_POSITION;
+				ancPosition = cache.get_node(ancPosition).parentPosition) {
+			auto& ancNode = cache.get_node(ancPosition);
+			auto& anc = *ancNode.instance;
+
+			if (anc.m_classID == InstanceClass::MESH_GEOM) {
+				at.recalc_world_transform(ecs.get_component<MeshGeom>(ancNode.entity)
+						.get_transform());
+				return;
+			}
+			else if (anc.is_a(InstanceClass::BASE_GEOM)) {
+				at.recalc_world_transform(ecs.get_component<Geometry>(ancNode.entity)
+						.get_transform());
+				return;
+			}
+			else if (anc.m_classID == classID) {
+				at.recalc_world_transform(ecs.get_component<Attachment_T>(ancNode.entity));
+				return;
+			}
+		}
+
+		at.recalc_world_transform(Math::Transform(1.f));
+	};
+
+	// Setters may run on jobs, so dirty attachments are found by their flag rather than queued
+	auto& dirtyPositions = ecs.get_context<AttachmentUpdateScratch>().dirtyPositions;
+	dirtyPositions.clear();
+
+	ecs.get_view<Attachment_T>().for_each([&](auto entity, auto& at) {
+		if (at.m_worldDirty) {
+			dirtyPositions.push_back(cache.find_position(entity));
+		}
+	});
+
+	// In pre-order every attachment comes after the attachments above it
+	std::sort(dirtyPositions.begin(), dirtyPositions.end());
+
+	for (auto position : dirtyPositions) {
+		if (position == HierarchyCache::INVALID_POSITION) {
+			break;
+		}
+
+		auto& node = cache.get_node(position);
+		auto& at = ecs.get_component<Attachment_T>(node.entity);
+
+		// Already updated along with a dirty attachment above it
+		if (!at.m_worldDirty) {
+			continue;
+		}
+
+		recalc(at, position);
+
+		std::span<const uint32_t> descendants;
+		cache.find_descendants_of_class(*node.instance, classID, descendants);
+
+		for (auto descPosition : descendants) {
+			recalc(ecs.get_component<Attachment_T>(cache.get_node(descPosition).entity),
+					descPosition);
+		}
+	}
+}
+
+}
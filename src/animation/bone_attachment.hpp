@@ -1,21 +1,32 @@
 #pragma once
 
+#include <cstdint>
+
 #include <ecs/ecs_fwd.hpp>
 
+#include <core/instance_class.hpp>
+
 #include <math/transform.hpp>
 
 namespace Game {
 
 struct Instance;
-	
+
+// Setters only mark the world transforms dirty, they are recomputed by update_world_transforms
 class BoneAttachment {
 	public:
 		static void create(ECS::Manager&, ECS::Entity);
 		static void on_ancestry_changed(ECS::Manager&, Instance&, ECS::Entity, Instance*,
 				ECS::Entity);
 
-		void set_local_transform(ECS::Manager&, Instance& selfInstance, Math::Transform);
-		void set_transform(ECS::Manager&, Instance& selfInstance, Math::Transform);
+		// Recomputes the world transforms of every dirty bone and the bones below it, parents
+		// before children. Called once per frame, rebuilds the hierarchy cache if it is stale.
+		static void update_world_transforms(ECS::Manager&);
+
+		void set_local_transform(Math::Transform);
+		void set_transform(Math::Transform);
+		// Has the world transforms recomputed by the next update_world_transforms
+		void mark_world_dirty();
 
 		const Math::Transform& get_local_transform() const;
 		const Math::Transform& get_world_transform() const;
@@ -29,11 +40,14 @@ class BoneAttachment {
 		Math::Transform m_transform = Math::Transform(1.f);
 		Math::Transform m_transformedTransform = Math::Transform(1.f);
 		Math::Transform m_transformedWorldTransform = Math::Transform(1.f);
+		bool m_worldDirty = true;
 
-		void recalc_world_transform(ECS::Manager&, Instance&);
+		// Placed by the transform of a geometry ancestor or by the parent bone
+		void recalc_world_transform(const Math::Transform& parentTransform);
+		void recalc_world_transform(const BoneAttachment& parent);
 
-		static void update_descendant_world_transforms(ECS::Manager&, Instance&,
-				const BoneAttachment&);
+		template <typename, InstanceClass>
+		friend void update_attachment_world_transforms(ECS::Manager&);
 };
 
 }
@@ -9,14 +9,16 @@
 
 #include <core/instance.hpp>
 #include <core/instance_utils.hpp>
+#include <core/hierarchy_cache.hpp>
 #include <core/model.hpp>
 #include <core/mesh_geom.hpp>
 #include <animation/bone_attachment.hpp>
 
 using namespace Game;
 
-static void update_rig_bones(ECS::Manager& ecs, Instance& rootPart,
-		const Math::Matrix4x4& parentTransform, RigComponent& rc);
+static void bind_bones(ECS::Manager& ecs, Instance& instBone, uint32_t parentBinding,
+		RigComponent& rc);
+static void pose_bones(ECS::Manager& ecs, RigComponent& rc);
 
 RigComponent::RigComponent(Memory::SharedPtr<Rig> rig, ECS::Entity rigContainer)
 		: m_rig(std::move(rig))
@@ -24,6 +26,8 @@ RigComponent::RigComponent(Memory::SharedPtr<Rig> rig, ECS::Entity rigContainer)
 		, m_rigContainer(rigContainer) {}
 
 void Game::update_rigs(ECS::Manager& ecs) {
+	const auto generation = ecs.get_context<HierarchyCache>().get_name_generation();
+
 	ecs.run_system<RigComponent>([&](auto eRigComponent, auto& rcomp) {
 		if (!ecs.is_valid_entity(rcomp.m_rigContainer)) {
 			return;
@@ -38,9 +42,20 @@ void Game::update_rigs(ECS::Manager& ecs) {
 				return;
 			}
 
-			auto& instPrimaryPart = ecs.get_component<Instance>(model.get_primary_part());
+			if (!rcomp.m_bound || rcomp.m_bindingGeneration != generation
+					|| rcomp.m_boundPrimaryPart != model.get_primary_part()) {
+				auto& instPrimaryPart = ecs.get_component<Instance>(model.get_primary_part());
+
+				rcomp.m_bindings.clear();
+				bind_bones(ecs, instPrimaryPart, RigComponent::INVALID_BINDING, rcomp);
+				rcomp.m_globalTransforms.resize(rcomp.m_bindings.size());
 
-			update_rig_bones(ecs, instPrimaryPart, Math::Matrix4x4(1.f), rcomp);
+				rcomp.m_bindingGeneration = generation;
+				rcomp.m_boundPrimaryPart = model.get_primary_part();
+				rcomp.m_bound = true;
+			}
+
+			pose_bones(ecs, rcomp);
 
 			auto* dstData = g_riggedMeshRenderer->get_or_add_rig_instance(*rcomp.m_rig,
 					eRigComponent);
@@ -50,25 +65,38 @@ void Game::update_rigs(ECS::Manager& ecs) {
 	});
 }
 
-static void update_rig_bones(ECS::Manager& ecs, Instance& instBone,
-		const Math::Matrix4x4& parentTransform, RigComponent& rc) {
+// Bones without a rig bone are skipped, their children are posed relative to the closest bone
+// above them
+static void bind_bones(ECS::Manager& ecs, Instance& instBone, uint32_t parentBinding,
+		RigComponent& rc) {
 	for_each_child(ecs, instBone, [&](auto entity, auto& child) {
 		if (child.m_classID == InstanceClass::BONE) {
-			auto& ba = ecs.get_component<BoneAttachment>(entity);
-			auto boneIndex = rc.m_rig->get_bone_index(child.m_name);
-
-			auto globalTransform = parentTransform;
+			auto boneIndex = rc.m_rig->get_bone_index(child.m_name.get_string());
+			auto binding = parentBinding;
 
 			if (boneIndex != Bone::INVALID_BONE_INDEX) {
-				auto& bone = rc.m_rig->get_bone(boneIndex);
-
-				//globalTransform *= ba.get_transform().to_matrix4x4();
-				globalTransform *= ba.get_transformed_transform().to_matrix4x4();
-				rc.m_finalBoneTransforms[boneIndex] = globalTransform * bone.inverseBind;
+				binding = static_cast<uint32_t>(rc.m_bindings.size());
+				rc.m_bindings.push_back({entity, boneIndex, parentBinding});
 			}
 
-			update_rig_bones(ecs, child, globalTransform, rc);
+			bind_bones(ecs, child, binding, rc);
 		}
 	});
 }
 
+static void pose_bones(ECS::Manager& ecs, RigComponent& rc) {
+	auto& bonePool = ecs.get_pool<BoneAttachment>();
+
+	for (size_t i = 0; i < rc.m_bindings.size(); ++i) {
+		auto& binding = rc.m_bindings[i];
+		auto& ba = bonePool.get(binding.entity);
+
+		auto& globalTransform = rc.m_globalTransforms[i];
+		globalTransform = binding.parentBinding != RigComponent::INVALID_BINDING
+				? rc.m_globalTransforms[binding.parentBinding] : Math::Matrix4x4(1.f);
+		globalTransform *= ba.get_transformed_transform().to_matrix4x4();
+
+		rc.m_finalBoneTransforms[binding.boneIndex] = globalTransform
+				* rc.m_rig->get_bone(binding.boneIndex).inverseBind;
+	}
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+
 #include <vector>
 
 #include <core/memory.hpp>
@@ -13,11 +15,28 @@ namespace Game {
 class Rig;
 
 struct RigComponent {
+	static constexpr uint32_t INVALID_BINDING = ~uint32_t{0};
+
+	// A bone attachment of the rig container and the rig bone it poses
+	struct BoneBinding {
+		ECS::Entity entity;
+		uint32_t boneIndex;
+		// Binding of the closest bone attachment above it, or INVALID_BINDING
+		uint32_t parentBinding;
+	};
+
 	explicit RigComponent(Memory::SharedPtr<Rig>, ECS::Entity);
 
 	Memory::SharedPtr<Rig> m_rig;
 	std::vector<Math::Matrix4x4> m_finalBoneTransforms;
 	ECS::Entity m_rigContainer;
+
+	// Resolved by name when the hierarchy or a name changes, parents before children
+	std::vector<BoneBinding> m_bindings;
+	std::vector<Math::Matrix4x4> m_globalTransforms;
+	uint64_t m_bindingGeneration = 0;
+	ECS::Entity m_boundPrimaryPart = ECS::INVALID_ENTITY;
+	bool m_bound = false;
 };
 
 void update_rigs(ECS::Manager&);
@@ -116,7 +116,7 @@ static void populate_bones(ECS::Manager& ecs, Rig& rig, ECS::Entity eParent, Bon
 	auto& ba = ecs.get_component<BoneAttachment>(eBone);
 
 	instBA->m_name = bone.name;
-	ba.set_local_transform(ecs, *instBA, Math::Transform(bone.localTransform));
+	ba.set_local_transform(Math::Transform(bone.localTransform));
 
 	instBA->set_parent(ecs, eParent, eBone);
 
@@ -445,10 +445,14 @@ static Pair<std::string, Memory::SharedPtr<Animation>> load_animation(const tiny
 	}
 
 	for (auto& [channelName, timeMap] : channelData) {
+		std::vector<Animation::Keyframe> keyframes;
+		keyframes.reserve(timeMap.size());
+
 		for (auto& [_, tfPair] : timeMap) {
-			anim->add_frame(channelName, tfPair.first, std::move(tfPair.second.position),
-					std::move(tfPair.second.rotation), std::move(tfPair.second.scale));
+			keyframes.push_back({tfPair.first, std::move(tfPair.second)});
 		}
+
+		anim->add_channel(channelName, std::move(keyframes));
 	}
 
 	g_animationCache->set(animData.name, anim);
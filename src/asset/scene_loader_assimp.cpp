@@ -173,6 +173,9 @@ static void load_animation(const aiAnimation& animData) {
 
 		//LOG_TEMP("Loading animation channel for bone %s", boneName.c_str());
 
+		std::vector<Animation::Keyframe> keyframes;
+		keyframes.reserve(channel.mNumRotationKeys);
+
 		for (uint32_t j = 0; j < channel.mNumRotationKeys; ++j) {
 			double dTime = channel.mRotationKeys[j].mTime / animData.mTicksPerSecond;
 			//auto iTime = static_cast<int32_t>(dTime * TIME_MULTIPLIER);
@@ -187,9 +190,11 @@ static void load_animation(const aiAnimation& animData) {
 			Math::Quaternion rot(keyRot.w, keyRot.x, keyRot.y, keyRot.z);
 			Math::Vector3 scl(keyScl.x, keyScl.y, keyScl.z);
 
-			anim->add_frame(boneName, static_cast<float>(dTime), std::move(pos), std::move(rot),
-					std::move(scl));
+			keyframes.push_back({static_cast<float>(dTime),
+					Math::BoneTransform{std::move(pos), std::move(rot), std::move(scl)}});
 		}
+
+		anim->add_channel(boneName, std::move(keyframes));
 	}
 
 	g_animationCache->set(animName, std::move(anim));
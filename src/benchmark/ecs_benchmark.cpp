@@ -0,0 +1,465 @@
+// Standalone ECS micro-benchmarks. Runs every case at several entity counts and prints the timings
+// as JSON on stdout, so results can be diffed against a baseline run. Needs no window or GPU.
+// ECSBenchmark64 is the same program built with USE_64_BIT_ENTITIES.
+//
+// Usage: ECSBenchmark [maxEntities]
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <core/events.hpp>
+
+#include <ecs/archetype_storage.hpp>
+#include <ecs/ecs.hpp>
+
+namespace {
+
+constexpr size_t ENTITY_COUNTS[] = {1'000, 10'000, 100'000, 1'000'000};
+constexpr size_t REPEAT_COUNT = 5;
+constexpr size_t DISPATCHER_HANDLER_COUNT = 8;
+
+struct Position {
+	float x, y, z;
+};
+
+struct Velocity {
+	float x, y, z;
+};
+
+struct Health {
+	int32_t value;
+
+	bool operator<(const Health& other) const {
+		return value < other.value;
+	}
+};
+
+struct Frozen {};
+
+// Heavier components, long enough names to defeat the small string optimization
+struct Name {
+	std::string value;
+};
+
+struct PagedName {
+	std::string value;
+};
+
+const std::string LONG_NAME = "BenchmarkInstanceWithALongName";
+
+}
+
+template <>
+struct ECS::ComponentStorageTraits<PagedName> {
+	static constexpr bool PAGED = true;
+};
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Written by every case so the measured work cannot be optimized away
+volatile float g_sink;
+
+bool g_firstResult = true;
+
+void print_result(std::string_view name, std::string_view backend, size_t entityCount,
+		const std::vector<double>& times) {
+	const double minTime = *std::min_element(times.begin(), times.end());
+	double meanTime = 0.0;
+
+	for (auto time : times) {
+		meanTime += time;
+	}
+
+	meanTime /= static_cast<double>(times.size());
+
+	printf("%s\n\t\t{\"name\": \"%.*s\", \"backend\": \"%.*s\", \"entities\": %zu, "
+			"\"entity_bits\": %zu, \"min_ms\": %.4f, \"mean_ms\": %.4f}",
+			g_firstResult ? "" : ",", static_cast<int>(name.size()), name.data(),
+			static_cast<int>(backend.size()), backend.data(), entityCount,
+			sizeof(ECS::Entity) * 8, minTime, meanTime);
+	fflush(stdout);
+
+	g_firstResult = false;
+}
+
+void print_memory_result(std::string_view name, std::string_view backend, size_t entityCount,
+		size_t bytes) {
+	printf("%s\n\t\t{\"name\": \"%.*s\", \"backend\": \"%.*s\", \"entities\": %zu, "
+			"\"entity_bits\": %zu, \"bytes\": %zu, \"bytes_per_entity\": %.2f}",
+			g_firstResult ? "" : ",", static_cast<int>(name.size()), name.data(),
+			static_cast<int>(backend.size()), backend.data(), entityCount,
+			sizeof(ECS::Entity) * 8, bytes, static_cast<double>(bytes) / entityCount);
+	fflush(stdout);
+
+	g_firstResult = false;
+}
+
+// setup(manager, entities) prepares a fresh manager, only run(manager, entities) is timed
+template <typename Manager, typename Setup, typename Run>
+void run_case(std::string_view name, std::string_view backend, size_t entityCount, Setup&& setup,
+		Run&& run) {
+	std::vector<double> times;
+	times.reserve(REPEAT_COUNT);
+
+	for (size_t i = 0; i < REPEAT_COUNT; ++i) {
+		Manager manager;
+		std::vector<ECS::Entity> entities;
+		entities.reserve(entityCount);
+
+		setup(manager, entities);
+
+		const auto start = Clock::now();
+		run(manager, entities);
+		const auto end = Clock::now();
+
+		times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+	}
+
+	print_result(name, backend, entityCount, times);
+}
+
+template <typename Manager>
+void create_entities(Manager& manager, std::vector<ECS::Entity>& entities, size_t count) {
+	for (size_t i = 0; i < count; ++i) {
+		entities.push_back(manager.create_entity());
+	}
+}
+
+template <typename Manager>
+void create_moving_entities(Manager& manager, std::vector<ECS::Entity>& entities, size_t count) {
+	for (size_t i = 0; i < count; ++i) {
+		auto entity = manager.create_entity();
+		entities.push_back(entity);
+
+		manager.template add_component<Position>(entity, static_cast<float>(i), 0.f, 0.f);
+
+		// Half of the entities move, so multi-pool views have to skip entities
+		if (i % 2 == 0) {
+			manager.template add_component<Velocity>(entity, 1.f, 2.f, 3.f);
+		}
+	}
+}
+
+// Cases shared by both storage backends, Manager is ECS::Manager or ECS::ArchetypeManager
+template <typename Manager>
+void run_common_cases(std::string_view backend, size_t count) {
+	auto noSetup = [](Manager&, std::vector<ECS::Entity>&) {};
+
+	auto createSetup = [&](Manager& manager, std::vector<ECS::Entity>& entities) {
+		create_entities(manager, entities, count);
+	};
+
+	auto movingSetup = [&](Manager& manager, std::vector<ECS::Entity>& entities) {
+		create_moving_entities(manager, entities, count);
+	};
+
+	run_case<Manager>("create_entities", backend, count, noSetup,
+			[&](Manager& manager, std::vector<ECS::Entity>& entities) {
+		create_entities(manager, entities, count);
+	});
+
+	run_case<Manager>("destroy_entities", backend, count, movingSetup,
+			[](Manager& manager, std::vector<ECS::Entity>& entities) {
+		for (auto entity : entities) {
+			manager.destroy_entity(entity);
+		}
+	});
+
+	run_case<Manager>("add_component", backend, count, createSetup,
+			[](Manager& manager, std::vector<ECS::Entity>& entities) {
+		for (auto entity : entities) {
+			manager.template add_component<Position>(entity, 1.f, 2.f, 3.f);
+		}
+	});
+
+	run_case<Manager>("remove_component", backend, count, [&](Manager& manager,
+			std::vector<ECS::Entity>& entities) {
+		create_entities(manager, entities, count);
+
+		for (auto entity : entities) {
+			manager.template add_component<Position>(entity, 1.f, 2.f, 3.f);
+		}
+	}, [](Manager& manager, std::vector<ECS::Entity>& entities) {
+		for (auto entity : entities) {
+			manager.template remove_component<Position>(entity);
+		}
+	});
+
+	run_case<Manager>("add_components_several", backend, count, createSetup,
+			[](Manager& manager, std::vector<ECS::Entity>& entities) {
+		for (auto entity : entities) {
+			manager.template add_component<Position>(entity, 1.f, 2.f, 3.f);
+			manager.template add_component<Velocity>(entity, 1.f, 2.f, 3.f);
+			manager.template add_component<Health>(entity, 100);
+			manager.template add_component<Frozen>(entity);
+		}
+	});
+
+	run_case<Manager>("remove_components_several", backend, count, [&](Manager& manager,
+			std::vector<ECS::Entity>& entities) {
+		create_entities(manager, entities, count);
+
+		for (auto entity : entities) {
+			manager.template add_component<Position>(entity, 1.f, 2.f, 3.f);
+			manager.template add_component<Velocity>(entity, 1.f, 2.f, 3.f);
+			manager.template add_component<Health>(entity, 100);
+			manager.template add_component<Frozen>(entity);
+		}
+	}, [](Manager& manager, std::vector<ECS::Entity>& entities) {
+		for (auto entity : entities) {
+			manager.template remove_component<Position>(entity);
+			manager.template remove_component<Velocity>(entity);
+			manager.template remove_component<Health>(entity);
+			manager.template remove_component<Frozen>(entity);
+		}
+	});
+
+	run_case<Manager>("view_single_pool", backend, count, movingSetup,
+			[](Manager& manager, std::vector<ECS::Entity>&) {
+		float sum = 0.f;
+
+		manager.template get_view<Position>().for_each([&](auto, auto& position) {
+			sum += position.x;
+		});
+
+		g_sink = sum;
+	});
+
+	run_case<Manager>("view_multi_pool", backend, count, movingSetup,
+			[](Manager& manager, std::vector<ECS::Entity>&) {
+		float sum = 0.f;
+
+		manager.template get_view<Position, Velocity>().for_each([&](auto, auto& position,
+				auto& velocity) {
+			position.x += velocity.x;
+			sum += position.x;
+		});
+
+		g_sink = sum;
+	});
+
+	run_case<Manager>("group_owned", backend, count, [&](Manager& manager,
+			std::vector<ECS::Entity>& entities) {
+		create_moving_entities(manager, entities, count);
+		manager.template get_group<Position, Velocity>();
+	}, [](Manager& manager, std::vector<ECS::Entity>&) {
+		float sum = 0.f;
+
+		manager.template get_group<Position, Velocity>().for_each([&](auto, auto& position,
+				auto& velocity) {
+			position.x += velocity.x;
+			sum += position.x;
+		});
+
+		g_sink = sum;
+	});
+
+	run_case<Manager>("sort_on_component", backend, count, [&](Manager& manager,
+			std::vector<ECS::Entity>& entities) {
+		std::mt19937 rng(12345);
+
+		create_entities(manager, entities, count);
+
+		for (auto entity : entities) {
+			manager.template add_component<Health>(entity, static_cast<int32_t>(rng()));
+			manager.template add_component<Position>(entity, 1.f, 2.f, 3.f);
+		}
+
+		manager.template get_group<Health, Position>();
+	}, [](Manager& manager, std::vector<ECS::Entity>&) {
+		manager.template get_group<Health, Position>().template sort_on_component<Health>();
+	});
+
+	run_case<Manager>("clear_pool", backend, count, movingSetup,
+			[](Manager& manager, std::vector<ECS::Entity>&) {
+		manager.template clear_pool<Position>();
+	});
+}
+
+void run_sparse_set_cases(size_t count) {
+	using ECS::Manager;
+
+	auto createSetup = [&](Manager& manager, std::vector<ECS::Entity>& entities) {
+		create_entities(manager, entities, count);
+	};
+
+	run_case<Manager>("destroy_entities_batch", "sparse_set", count, [&](Manager& manager,
+			std::vector<ECS::Entity>& entities) {
+		create_moving_entities(manager, entities, count);
+	}, [](Manager& manager, std::vector<ECS::Entity>& entities) {
+		manager.destroy_entities(entities);
+	});
+
+	// Vector storage moves every name when the pool grows, paged storage never moves them
+	run_case<Manager>("add_component_string", "sparse_set", count, createSetup,
+			[](Manager& manager, std::vector<ECS::Entity>& entities) {
+		for (auto entity : entities) {
+			manager.add_component<Name>(entity, LONG_NAME);
+		}
+	});
+
+	run_case<Manager>("add_component_string_paged", "sparse_set", count, createSetup,
+			[](Manager& manager, std::vector<ECS::Entity>& entities) {
+		for (auto entity : entities) {
+			manager.add_component<PagedName>(entity, LONG_NAME);
+		}
+	});
+
+	run_case<Manager>("view_single_pool_paged", "sparse_set", count, [&](Manager& manager,
+			std::vector<ECS::Entity>& entities) {
+		create_entities(manager, entities, count);
+
+		for (auto entity : entities) {
+			manager.add_component<PagedName>(entity, LONG_NAME);
+		}
+	}, [](Manager& manager, std::vector<ECS::Entity>&) {
+		size_t totalLength = 0;
+
+		manager.get_view<PagedName>().for_each([&](auto, auto& name) {
+			totalLength += name.value.size();
+		});
+
+		g_sink = static_cast<float>(totalLength);
+	});
+
+	// Two large pools that rarely overlap, views test every entity of the smaller pool while the
+	// query only walks the matching ones
+	auto sparseOverlapSetup = [&](Manager& manager, std::vector<ECS::Entity>& entities) {
+		for (size_t i = 0; i < count; ++i) {
+			auto entity = manager.create_entity();
+			entities.push_back(entity);
+
+			if (i % 2 == 0) {
+				manager.add_component<Position>(entity, static_cast<float>(i), 0.f, 0.f);
+			}
+
+			if (i % 2 == 1 || i % 100 == 0) {
+				manager.add_component<Velocity>(entity, 1.f, 2.f, 3.f);
+			}
+		}
+
+		manager.get_query<ECS::Include<Position, Velocity>>();
+	};
+
+	run_case<Manager>("view_sparse_overlap", "sparse_set", count, sparseOverlapSetup,
+			[](Manager& manager, std::vector<ECS::Entity>&) {
+		float sum = 0.f;
+
+		manager.get_view<Position, Velocity>().for_each([&](auto, auto& position,
+				auto& velocity) {
+			position.x += velocity.x;
+			sum += position.x;
+		});
+
+		g_sink = sum;
+	});
+
+	run_case<Manager>("query_sparse_overlap", "sparse_set", count, sparseOverlapSetup,
+			[](Manager& manager, std::vector<ECS::Entity>&) {
+		float sum = 0.f;
+
+		manager.get_query<ECS::Include<Position, Velocity>>().for_each([&](auto,
+				auto& position, auto& velocity) {
+			position.x += velocity.x;
+			sum += position.x;
+		});
+
+		g_sink = sum;
+	});
+
+	// Transient per-frame flags: tag every entity, then clear the tag pool
+	run_case<Manager>("tag_add_and_clear", "sparse_set", count, [&](Manager& manager,
+			std::vector<ECS::Entity>& entities) {
+		create_entities(manager, entities, count);
+	}, [](Manager& manager, std::vector<ECS::Entity>& entities) {
+		for (auto entity : entities) {
+			manager.add_component<Frozen>(entity);
+		}
+
+		manager.clear_pool<Frozen>();
+	});
+}
+
+// Storage used by the pools of count entities with a Position and every other one with a Velocity,
+// run with both entity widths to compare
+void run_memory_cases(size_t count) {
+	ECS::Manager manager;
+	std::vector<ECS::Entity> entities;
+	entities.reserve(count);
+
+	create_moving_entities(manager, entities, count);
+
+	print_memory_result("pool_memory", "sparse_set", count,
+			manager.get_pool<Position>().get_memory_usage()
+			+ manager.get_pool<Velocity>().get_memory_usage());
+}
+
+void run_dispatcher_cases(size_t count) {
+	// Fires count events, each reaching DISPATCHER_HANDLER_COUNT handlers
+	std::vector<double> times;
+	times.reserve(REPEAT_COUNT);
+
+	for (size_t i = 0; i < REPEAT_COUNT; ++i) {
+		Event::Dispatcher<ECS::Entity, Position&> dispatcher;
+		float sum = 0.f;
+
+		for (size_t j = 0; j < DISPATCHER_HANDLER_COUNT; ++j) {
+			dispatcher.connect([&sum](ECS::Entity, Position& position) {
+				sum += position.x;
+			});
+		}
+
+		Position position{1.f, 2.f, 3.f};
+
+		const auto start = Clock::now();
+
+		for (size_t j = 0; j < count; ++j) {
+			dispatcher.fire(static_cast<ECS::Entity>(j), position);
+		}
+
+		const auto end = Clock::now();
+
+		g_sink = sum;
+		times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+	}
+
+	print_result("dispatcher_fan_out", "event", count, times);
+}
+
+}
+
+int main(int argc, char** argv) {
+	size_t maxEntities = ENTITY_COUNTS[std::size(ENTITY_COUNTS) - 1];
+
+	if (argc > 1) {
+		maxEntities = std::strtoull(argv[1], nullptr, 10);
+	}
+
+	printf("{\n\t\"benchmarks\": [");
+
+	for (auto count : ENTITY_COUNTS) {
+		if (count > maxEntities) {
+			break;
+		}
+
+		run_common_cases<ECS::Manager>("sparse_set", count);
+		run_sparse_set_cases(count);
+		run_memory_cases(count);
+		run_common_cases<ECS::ArchetypeManager>("archetype", count);
+		run_dispatcher_cases(count);
+	}
+
+	printf("\n\t]\n}\n");
+
+	return 0;
+}
@@ -0,0 +1,77 @@
+#include "ancestry_change_queue.hpp"
+
+#include <ecs/ecs.hpp>
+
+#include <core/ancestry_changed_callbacks.hpp>
+#include <core/instance_utils.hpp>
+
+#include <algorithm>
+#include <iterator>
+
+using namespace Game;
+
+void Game::AncestryChangeQueue::flush(ECS::Manager& ecs) {
+	while (!m_roots.empty()) {
+		m_flushRoots.swap(m_roots);
+		m_roots.clear();
+
+		std::sort(m_flushRoots.begin(), m_flushRoots.end());
+		m_flushRoots.erase(std::unique(m_flushRoots.begin(), m_flushRoots.end()),
+				m_flushRoots.end());
+
+		auto queueChange = [&](ECS::Entity entity, const Instance& inst, ECS::Entity rootParent) {
+			if (ancestryChangedCallbacks[static_cast<uint32_t>(inst.m_classID)]) {
+				m_changesByClass[static_cast<uint32_t>(inst.m_classID)].push_back({entity,
+						rootParent});
+			}
+		};
+
+		for (auto root : m_flushRoots) {
+			// Destroyed since it was queued, its index may have been reused by another entity
+			if (!ecs.is_valid_entity(root) || !ecs.has_component<Instance>(root)) {
+				continue;
+			}
+
+			auto& rootInst = ecs.get_component<Instance>(root);
+			bool hasQueuedAncestor = false;
+
+			for_each_ancestor_cond(ecs, rootInst, [&](auto ancestor, auto&) {
+				hasQueuedAncestor = std::binary_search(m_flushRoots.begin(), m_flushRoots.end(),
+						ancestor);
+				return hasQueuedAncestor ? IterationDecision::BREAK : IterationDecision::CONTINUE;
+			});
+
+			if (hasQueuedAncestor) {
+				continue;
+			}
+
+			queueChange(root, rootInst, rootInst.m_parent);
+
+			for_each_descendant(ecs, rootInst, [&](auto entity, auto& inst) {
+				queueChange(entity, inst, rootInst.m_parent);
+			});
+		}
+
+		for (uint32_t classID = 0; classID < std::size(m_changesByClass); ++classID) {
+			auto callback = ancestryChangedCallbacks[classID];
+
+			// Callbacks that reparent instances queue new roots for the next pass
+			for (auto& change : m_changesByClass[classID]) {
+				// Earlier callbacks may have destroyed the instance or the parent
+				if (!ecs.is_valid_entity(change.entity)
+						|| !ecs.has_component<Instance>(change.entity)) {
+					continue;
+				}
+
+				auto* parentInst = ecs.is_valid_entity(change.rootParent)
+						&& ecs.has_component<Instance>(change.rootParent)
+						? &ecs.get_component<Instance>(change.rootParent) : nullptr;
+
+				callback(ecs, ecs.get_component<Instance>(change.entity), change.entity,
+						parentInst, parentInst ? change.rootParent : ECS::INVALID_ENTITY);
+			}
+
+			m_changesByClass[classID].clear();
+		}
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+
+#include <vector>
+
+#include <ecs/ecs_fwd.hpp>
+
+#include <core/instance_class.hpp>
+
+namespace Game {
+
+// Roots of the subtrees reparented since the last flush. Reparenting the same subtree several
+// times, or a subtree and one of its descendants, costs one traversal at the next flush. Lives
+// in the manager's context.
+class AncestryChangeQueue {
+	public:
+		void push(ECS::Entity root) {
+			m_roots.push_back(root);
+		}
+
+		// Runs the ancestry changed callback of every instance in the queued subtrees once, class
+		// by class. Each callback is passed the current parent of its subtree's root. Subtrees
+		// reparented by the callbacks are flushed as well.
+		void flush(ECS::Manager&);
+	private:
+		struct Change {
+			ECS::Entity entity;
+			ECS::Entity rootParent;
+		};
+
+		std::vector<ECS::Entity> m_roots;
+		std::vector<ECS::Entity> m_flushRoots;
+		std::vector<Change> m_changesByClass[static_cast<uint32_t>(InstanceClass::NUM_CLASSES)];
+};
+
+}
@@ -8,7 +8,8 @@ namespace Game {
 
 struct Instance;
 
-// (ecs, selfInst, selfEntity, childInst, childEntity, parentInst, parentEntity)
+// (ecs, selfInst, selfEntity, parentInst, parentEntity), called by AncestryChangeQueue::flush
+// with the parent of the reparented subtree's root
 using AncestryChangedCallback = void(ECS::Manager&, Game::Instance&, ECS::Entity, Game::Instance*,
 		ECS::Entity);
 
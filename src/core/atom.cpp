@@ -0,0 +1,73 @@
+#include "atom.hpp"
+
+#include <core/hashed_string.hpp>
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+
+struct ViewHash {
+	size_t operator()(std::string_view str) const {
+		return static_cast<size_t>(fast_string_hash(str));
+	}
+};
+
+}
+
+struct AtomTable {
+	std::mutex mutex;
+	// Keys view the string of their entry
+	std::unordered_map<std::string_view, std::unique_ptr<Atom::Entry>, ViewHash> entries;
+};
+
+static AtomTable& get_atom_table() {
+	static AtomTable table;
+	return table;
+}
+
+Atom::Atom(std::string_view str) {
+	if (str.empty()) {
+		return;
+	}
+
+	auto& table = get_atom_table();
+	std::scoped_lock lock(table.mutex);
+
+	if (auto it = table.entries.find(str); it != table.entries.end()) {
+		m_entry = it->second.get();
+		return;
+	}
+
+	auto pEntry = std::make_unique<Entry>(Entry{std::string(str), fast_string_hash(str)});
+	m_entry = pEntry.get();
+	table.entries.emplace(pEntry->string, std::move(pEntry));
+}
+
+bool Atom::find(std::string_view str, Atom& result) {
+	if (str.empty()) {
+		result = Atom();
+		return true;
+	}
+
+	auto& table = get_atom_table();
+	std::scoped_lock lock(table.mutex);
+
+	if (auto it = table.entries.find(str); it != table.entries.end()) {
+		result = Atom(it->second.get());
+		return true;
+	}
+
+	return false;
+}
+
+const std::string& Atom::get_string() const {
+	static const std::string EMPTY;
+	return m_entry ? m_entry->string : EMPTY;
+}
+
+uint64_t Atom::get_hash() const {
+	static constexpr uint64_t EMPTY_HASH = fast_string_hash("");
+	return m_entry ? m_entry->hash : EMPTY_HASH;
+}
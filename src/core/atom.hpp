@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+
+#include <string>
+#include <string_view>
+
+// Handle to a string interned in a global table. Equal strings share one entry, so atoms compare
+// by pointer, the hash is computed once per distinct string and each distinct string is stored
+// once. Entries are never freed. The default atom is the empty string.
+class Atom {
+	public:
+		Atom() = default;
+		Atom(std::string_view);
+		Atom(const char* str)
+				: Atom(std::string_view(str)) {}
+		Atom(const std::string& str)
+				: Atom(std::string_view(str)) {}
+
+		// Looks str up without interning it, returns false if no atom for str exists
+		static bool find(std::string_view str, Atom& result);
+
+		const std::string& get_string() const;
+		uint64_t get_hash() const;
+
+		bool empty() const {
+			return m_entry == nullptr;
+		}
+
+		bool operator==(const Atom& other) const {
+			return m_entry == other.m_entry;
+		}
+
+		bool operator!=(const Atom& other) const {
+			return m_entry != other.m_entry;
+		}
+
+		struct Hash {
+			size_t operator()(const Atom& atom) const {
+				return static_cast<size_t>(atom.get_hash());
+			}
+		};
+	private:
+		friend struct AtomTable;
+
+		struct Entry {
+			std::string string;
+			uint64_t hash;
+		};
+
+		const Entry* m_entry = nullptr;
+
+		explicit Atom(const Entry* entry)
+				: m_entry(entry) {}
+};
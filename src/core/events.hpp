@@ -1,81 +1,336 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
-#include <functional>
+
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace Event {
 
+// Handlers are stored contiguously and called in connection order. Functors of up to
+// INLINE_FUNCTOR_SIZE bytes are stored in their slot and the first INLINE_HANDLER_COUNT slots are
+// stored in the dispatcher itself, so connecting a small lambda to a lightly used event does not
+// allocate. Handlers may connect and disconnect handlers of the dispatcher they are called from,
+// the changes are applied once the outermost dispatch returns.
 template <typename... Args>
 class Dispatcher {
 	public:
 		using function_type = void(Args...);
 
+		static constexpr size_t INLINE_FUNCTOR_SIZE = 3 * sizeof(void*);
+		static constexpr size_t INLINE_HANDLER_COUNT = 2;
+		static constexpr uint32_t INVALID_ID = 0;
+
+		// A default constructed connection is not connected to any handler
 		class Connection {
-			template <typename Functor>
-			explicit Connection(Functor&& func, Connection* next)
-					: m_function(func)
-					, m_next(next) {}
+			public:
+				Connection() = default;
 
-			std::function<function_type> m_function;
-			Connection* m_next;
+				bool is_connected() const {
+					return m_id != INVALID_ID;
+				}
+			private:
+				explicit Connection(uint32_t id)
+						: m_id(id) {}
 
-			friend class Dispatcher;
+				uint32_t m_id = INVALID_ID;
+
+				friend class Dispatcher;
 		};
 
+		Dispatcher() = default;
+
 		~Dispatcher() {
-			auto* curr = m_head;
+			clear();
+		}
 
-			while (curr) {
-				auto* next = curr->m_next;
-				delete curr;
-				curr = next;
+		Dispatcher(Dispatcher&& other) noexcept {
+			*this = std::move(other);
+		}
+
+		Dispatcher& operator=(Dispatcher&& other) noexcept {
+			if (this != &other) {
+				clear();
+
+				for (uint32_t i = 0; i < other.m_size; ++i) {
+					push_slot() = std::move(other.get_slot(i));
+				}
+
+				m_pending = std::move(other.m_pending);
+				m_nextID = other.m_nextID;
+				other.clear();
 			}
+
+			return *this;
 		}
 
+		Dispatcher(const Dispatcher&) = delete;
+		void operator=(const Dispatcher&) = delete;
+
 		template <typename Functor>
-		Connection* connect(Functor&& func) {
-			m_head = new Connection(func, m_head);
-			return m_head;
+		Connection connect(Functor&& func) {
+			const uint32_t id = m_nextID++;
+
+			if (m_nextID == INVALID_ID) {
+				m_nextID = 1;
+			}
+
+			// Slots must not move while their handlers run
+			auto& slot = m_firingDepth > 0 ? m_pending.emplace_back() : push_slot();
+			slot.assign(std::forward<Functor>(func), id);
+
+			return Connection(id);
 		}
 
-		void disconnect(Connection* con) {
-			if (con == m_head) {
-				m_head = m_head->m_next;
-				delete con;
+		// A handler disconnected during a dispatch is not called again by that dispatch
+		void disconnect(Connection con) {
+			if (con.m_id == INVALID_ID) {
 				return;
 			}
 
-			auto* last = m_head;
-			auto* curr = m_head->m_next;
+			for (uint32_t i = 0; i < m_size; ++i) {
+				auto& slot = get_slot(i);
+
+				if (slot.id == con.m_id && slot.invoke) {
+					if (m_firingDepth > 0) {
+						// Destroying the functor is deferred, it may be the one running
+						slot.invoke = nullptr;
+						m_hasDisconnected = true;
+					}
+					else {
+						erase_slot(i);
+					}
 
-			while (curr) {
-				if (curr == con) {
-					last->m_next = con->m_next;
-					delete con;
 					return;
 				}
+			}
 
-				last = curr;
-				curr = curr->m_next;
+			for (auto it = m_pending.begin(), end = m_pending.end(); it != end; ++it) {
+				if (it->id == con.m_id) {
+					m_pending.erase(it);
+					return;
+				}
 			}
 		}
 
 		template <typename... Args2>
 		void fire(Args2&&... args) {
-			auto* curr = m_head;
+			if (m_size == 0) {
+				return;
+			}
+
+			++m_firingDepth;
 
-			while (curr) {
-				curr->m_function(std::forward<Args2>(args)...);
-				curr = curr->m_next;
+			if (m_size == 1) {
+				m_inlineSlots[0].call(args...);
 			}
+			else {
+				for (uint32_t i = 0, l = m_size; i < l; ++i) {
+					get_slot(i).call(args...);
+				}
+			}
+
+			end_dispatch();
+		}
+
+		// Fires once for each of count elements, each argument is passed as a pointer to count
+		// consecutive values. Every element is passed to a handler before moving on to the next
+		// handler.
+		template <typename... Ptrs>
+		void fire_range(size_t count, Ptrs*... arrays) {
+			if (m_size == 0 || count == 0) {
+				return;
+			}
+
+			++m_firingDepth;
+
+			for (uint32_t i = 0, l = m_size; i < l; ++i) {
+				auto& slot = get_slot(i);
+
+				for (size_t j = 0; j < count && slot.invoke; ++j) {
+					slot.invoke(slot.storage, arrays[j]...);
+				}
+			}
+
+			end_dispatch();
 		}
 
 		bool empty() const {
-			return m_head == nullptr;
+			return m_size == 0 && m_pending.empty();
 		}
 	private:
-		Connection* m_head = nullptr;
+		struct Slot {
+			alignas(void*) std::byte storage[INLINE_FUNCTOR_SIZE];
+			void (*invoke)(void*, Args...) = nullptr;
+			// Move constructs the functor in dst from src and destroys src, or destroys dst when
+			// src is null
+			void (*manage)(void* dst, void* src) = nullptr;
+			uint32_t id = 0;
+
+			Slot() = default;
+
+			Slot(Slot&& other) noexcept {
+				*this = std::move(other);
+			}
+
+			Slot& operator=(Slot&& other) noexcept {
+				reset();
+
+				if (other.manage) {
+					other.manage(storage, other.storage);
+					invoke = other.invoke;
+					manage = other.manage;
+					id = other.id;
+
+					other.invoke = nullptr;
+					other.manage = nullptr;
+				}
+
+				return *this;
+			}
+
+			~Slot() {
+				reset();
+			}
+
+			template <typename Functor>
+			void assign(Functor&& func, uint32_t slotID) {
+				using F = std::decay_t<Functor>;
+
+				if constexpr (sizeof(F) <= INLINE_FUNCTOR_SIZE && alignof(F) <= alignof(void*)
+						&& std::is_nothrow_move_constructible_v<F>) {
+					new (storage) F(std::forward<Functor>(func));
+
+					invoke = [](void* p, Args... args) {
+						(*std::launder(static_cast<F*>(p)))(std::forward<Args>(args)...);
+					};
+
+					manage = [](void* dst, void* src) {
+						if (src) {
+							auto* pSrc = std::launder(static_cast<F*>(src));
+							new (dst) F(std::move(*pSrc));
+							pSrc->~F();
+						}
+						else {
+							std::launder(static_cast<F*>(dst))->~F();
+						}
+					};
+				}
+				else {
+					new (storage) F*(new F(std::forward<Functor>(func)));
+
+					invoke = [](void* p, Args... args) {
+						(**std::launder(static_cast<F**>(p)))(std::forward<Args>(args)...);
+					};
+
+					manage = [](void* dst, void* src) {
+						if (src) {
+							new (dst) F*(*std::launder(static_cast<F**>(src)));
+						}
+						else {
+							delete *std::launder(static_cast<F**>(dst));
+						}
+					};
+				}
+
+				id = slotID;
+			}
+
+			template <typename... Args2>
+			void call(Args2&... args) {
+				if (invoke) {
+					invoke(storage, args...);
+				}
+			}
+
+			void reset() {
+				if (manage) {
+					manage(storage, nullptr);
+					invoke = nullptr;
+					manage = nullptr;
+				}
+			}
+		};
+
+		Slot m_inlineSlots[INLINE_HANDLER_COUNT];
+		std::vector<Slot> m_overflowSlots;
+		// Handlers connected during a dispatch
+		std::vector<Slot> m_pending;
+		uint32_t m_size = 0;
+		uint32_t m_nextID = 1;
+		uint32_t m_firingDepth = 0;
+		bool m_hasDisconnected = false;
+
+		Slot& get_slot(uint32_t index) {
+			return index < INLINE_HANDLER_COUNT ? m_inlineSlots[index]
+					: m_overflowSlots[index - INLINE_HANDLER_COUNT];
+		}
+
+		Slot& push_slot() {
+			return m_size++ < INLINE_HANDLER_COUNT ? m_inlineSlots[m_size - 1]
+					: m_overflowSlots.emplace_back();
+		}
+
+		void erase_slot(uint32_t index) {
+			for (uint32_t i = index + 1; i < m_size; ++i) {
+				get_slot(i - 1) = std::move(get_slot(i));
+			}
+
+			pop_slot();
+		}
+
+		void pop_slot() {
+			if (--m_size < INLINE_HANDLER_COUNT) {
+				m_inlineSlots[m_size].reset();
+			}
+			else {
+				m_overflowSlots.pop_back();
+			}
+		}
+
+		void end_dispatch() {
+			if (--m_firingDepth > 0 || (!m_hasDisconnected && m_pending.empty())) {
+				return;
+			}
+
+			if (m_hasDisconnected) {
+				uint32_t numKept = 0;
+
+				for (uint32_t i = 0; i < m_size; ++i) {
+					if (get_slot(i).invoke) {
+						if (i != numKept) {
+							get_slot(numKept) = std::move(get_slot(i));
+						}
+
+						++numKept;
+					}
+				}
+
+				while (m_size > numKept) {
+					pop_slot();
+				}
+
+				m_hasDisconnected = false;
+			}
+
+			for (auto& slot : m_pending) {
+				push_slot() = std::move(slot);
+			}
+
+			m_pending.clear();
+		}
+
+		void clear() {
+			while (m_size > 0) {
+				pop_slot();
+			}
+
+			m_pending.clear();
+			m_hasDisconnected = false;
+		}
 };
 
 }
-
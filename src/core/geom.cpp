@@ -17,6 +17,23 @@ void Geometry::create(ECS::Manager& ecs, ECS::Entity entity) {
 	ecs.add_component<Geometry>(entity);
 }
 
+void Geometry::clone(ECS::Manager& ecs, ECS::Entity prototype, ECS::Entity entity) {
+	auto& part = ecs.add_component<Geometry>(entity);
+	part = ecs.get_component<Geometry>(prototype);
+
+	if (part.m_transparency == 1.f) {
+		return;
+	}
+
+	auto& inst = g_partRenderer->get_or_add_instance(part.m_shape, part.m_transparency == 0.f,
+			entity);
+	// The prototype is already in the bucket, so getting it does not move inst
+	auto& protoInst = g_partRenderer->get_or_add_instance(part.m_shape,
+			part.m_transparency == 0.f, prototype);
+
+	memcpy(&inst, &protoInst, sizeof(GeomInstance));
+}
+
 void Geometry::on_destroyed(ECS::Manager& ecs, Instance&, ECS::Entity selfEntity) {
 	auto& part = ecs.get_component<Geometry>(selfEntity);
 	g_partRenderer->remove_instance(part.m_shape, part.m_transparency == 0.f, selfEntity);
@@ -27,6 +44,7 @@ void Geometry::set_transform(ECS::Entity selfEntity, Math::Transform transform)
 	memcpy(&inst.m_transform, &transform, sizeof(Math::Transform));
 
 	m_transform = std::move(transform);
+	++m_transformVersion;
 }
 
 void Geometry::set_size(ECS::Entity selfEntity, Math::Vector3 size) {
@@ -113,6 +131,10 @@ const Math::Transform& Geometry::get_transform() const {
 	return m_transform;
 }
 
+uint32_t Geometry::get_transform_version() const {
+	return m_transformVersion;
+}
+
 const Math::Vector3& Geometry::get_size() const {
 	return m_size;
 }
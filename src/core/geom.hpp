@@ -17,6 +17,8 @@ struct Instance;
 class Geometry {
 	public:
 		static void create(ECS::Manager&, ECS::Entity);
+		// Adds a copy of the geom of prototype to entity, sharing its render state
+		static void clone(ECS::Manager&, ECS::Entity prototype, ECS::Entity entity);
 		static void on_destroyed(ECS::Manager&, Instance&, ECS::Entity);
 		static void on_ancestry_changed(ECS::Manager&, Instance&, ECS::Entity, Instance*,
 				ECS::Entity);
@@ -31,6 +33,8 @@ class Geometry {
 		void set_shape(ECS::Entity selfEntity, GeomType);
 
 		const Math::Transform& get_transform() const;
+		// Changes whenever the transform is set
+		uint32_t get_transform_version() const;
 		const Math::Vector3& get_size() const;
 		Math::Color3uint8 get_color() const;
 		
@@ -41,6 +45,7 @@ class Geometry {
 		GeomType get_shape() const;
 	private:
 		Math::Transform m_transform;
+		uint32_t m_transformVersion = 0;
 		Math::Vector3 m_size;
 		Math::Color3uint8 m_color;
 		float m_transparency;
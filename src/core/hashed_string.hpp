@@ -1,5 +1,9 @@
 #pragma once
 
+#include <cstdint>
+
+#include <string_view>
+
 // FNV-11 hash or something, TODO: look this up
 constexpr uint64_t fast_string_hash(const char* str) {
 	uint64_t hashVal = 0xcbf29ce484222325ULL;
@@ -12,6 +16,18 @@ constexpr uint64_t fast_string_hash(const char* str) {
 	return hashVal;
 }
 
+// Same hash as above for strings that are not null terminated
+constexpr uint64_t fast_string_hash(std::string_view str) {
+	uint64_t hashVal = 0xcbf29ce484222325ULL;
+
+	for (char c : str) {
+		hashVal *= 0x100000001b3ULL;
+		hashVal ^= c;
+	}
+
+	return hashVal;
+}
+
 constexpr uint64_t operator "" _hs(const char* str, size_t) {
 	return fast_string_hash(str);
 }
@@ -0,0 +1,132 @@
+#include "hierarchy_cache.hpp"
+
+#include <ecs/ecs.hpp>
+
+#include <core/instance.hpp>
+
+#include <algorithm>
+
+using namespace Game;
+
+void Game::HierarchyCache::update(ECS::Manager& ecs) {
+	if (m_valid) {
+		return;
+	}
+
+	m_nodes.clear();
+
+	ecs.get_view<Instance>().for_each([&](auto entity, auto& inst) {
+		if (inst.m_parent == ECS::INVALID_ENTITY) {
+			append_tree(ecs, entity, inst);
+		}
+	});
+
+	for (auto& positions : m_classPositions) {
+		positions.clear();
+	}
+
+	for (uint32_t i = 0; i < m_nodes.size(); ++i) {
+		m_classPositions[static_cast<uint32_t>(m_nodes[i].instance->m_classID)].push_back(i);
+	}
+
+	m_valid = true;
+}
+
+bool Game::HierarchyCache::find_descendants(const Instance& instance,
+		std::span<const Node>& result) const {
+	if (instance.m_firstChild == ECS::INVALID_ENTITY) {
+		result = {};
+		return true;
+	}
+
+	const auto firstChildPos = find_position(instance.m_firstChild);
+
+	if (firstChildPos == INVALID_POSITION) {
+		return false;
+	}
+
+	// The first child directly follows its parent
+	auto& node = m_nodes[firstChildPos - 1];
+	result = {m_nodes.data() + firstChildPos, node.subtreeSize - 1};
+
+	return true;
+}
+
+bool Game::HierarchyCache::find_descendants_of_class(const Instance& instance,
+		InstanceClass classID, std::span<const uint32_t>& result) const {
+	std::span<const Node> descendants;
+
+	if (!find_descendants(instance, descendants)) {
+		return false;
+	}
+
+	if (descendants.empty()) {
+		result = {};
+		return true;
+	}
+
+	const auto first = static_cast<uint32_t>(descendants.data() - m_nodes.data());
+	const auto last = first + static_cast<uint32_t>(descendants.size());
+	auto& positions = m_classPositions[static_cast<uint32_t>(classID)];
+
+	auto begin = std::lower_bound(positions.begin(), positions.end(), first);
+	auto end = std::lower_bound(begin, positions.end(), last);
+	result = {positions.data() + (begin - positions.begin()), static_cast<size_t>(end - begin)};
+
+	return true;
+}
+
+// Walks the tree depth first without recursion, following the parent links back up once a
+// subtree has been appended
+void Game::HierarchyCache::append_tree(ECS::Manager& ecs, ECS::Entity rootEntity, Instance& root) {
+	append_node(rootEntity, root, 0, INVALID_POSITION);
+
+	auto entity = rootEntity;
+	auto* pInst = &root;
+	uint32_t position = static_cast<uint32_t>(m_nodes.size() - 1);
+
+	for (;;) {
+		if (pInst->m_firstChild != ECS::INVALID_ENTITY) {
+			entity = pInst->m_firstChild;
+			pInst = &ecs.get_component<Instance>(entity);
+			append_node(entity, *pInst, m_nodes[position].depth + 1, position);
+			position = static_cast<uint32_t>(m_nodes.size() - 1);
+			continue;
+		}
+
+		// Close finished subtrees until one of them has a next sibling
+		for (;;) {
+			m_nodes[position].subtreeSize = static_cast<uint32_t>(m_nodes.size()) - position;
+
+			if (entity == rootEntity) {
+				return;
+			}
+
+			const auto parentPosition = m_nodes[position].parentPosition;
+
+			if (pInst->m_nextChild != ECS::INVALID_ENTITY) {
+				entity = pInst->m_nextChild;
+				pInst = &ecs.get_component<Instance>(entity);
+				append_node(entity, *pInst, m_nodes[position].depth, parentPosition);
+				position = static_cast<uint32_t>(m_nodes.size() - 1);
+				break;
+			}
+
+			position = parentPosition;
+			entity = m_nodes[position].entity;
+			pInst = m_nodes[position].instance;
+		}
+	}
+}
+
+void Game::HierarchyCache::append_node(ECS::Entity entity, Instance& inst, uint32_t depth,
+		uint32_t parentPosition) {
+	const auto index = ECS::get_index(entity);
+
+	if (index >= m_positions.size()) {
+		m_positions.resize(index + 1, INVALID_POSITION);
+	}
+
+	m_positions[index] = static_cast<uint32_t>(m_nodes.size());
+	m_nodes.push_back({entity, depth, 1, parentPosition, &inst});
+}
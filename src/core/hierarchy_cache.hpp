@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+
+#include <span>
+#include <vector>
+
+#include <ecs/ecs_fwd.hpp>
+
+#include <core/instance_class.hpp>
+
+namespace Game {
+
+struct Instance;
+
+// Every instance tree laid out in pre-order, so the descendants of an instance are the
+// contiguous range of nodes that follows it. Changes to the hierarchy only mark the cache stale,
+// it is rebuilt from the child lists by the next update(). While stale, hierarchy traversals
+// fall back to walking the child lists. Lives in the manager's context.
+class HierarchyCache {
+	public:
+		static constexpr uint32_t INVALID_POSITION = ~uint32_t{0};
+
+		struct Node {
+			ECS::Entity entity;
+			uint32_t depth;
+			// Number of nodes in the subtree, including this one
+			uint32_t subtreeSize;
+			uint32_t parentPosition;
+			// Instances are stored in pages that never move
+			Instance* instance;
+		};
+
+		// Rebuilds the cache if the hierarchy changed since the last update
+		void update(ECS::Manager&);
+
+		void invalidate() {
+			m_valid = false;
+			++m_generation;
+			++m_nameGeneration;
+		}
+
+		bool is_valid() const {
+			return m_valid;
+		}
+
+		// Names are not cached, but data derived from the hierarchy may have been resolved by name
+		void note_renamed() {
+			++m_nameGeneration;
+		}
+
+		// Changes whenever the hierarchy does, so data derived from it can be revalidated
+		uint64_t get_generation() const {
+			return m_generation;
+		}
+
+		// Changes whenever the hierarchy or a name does, for data resolved by name such as bone
+		// bindings
+		uint64_t get_name_generation() const {
+			return m_nameGeneration;
+		}
+
+		uint32_t find_position(ECS::Entity entity) const {
+			const auto index = ECS::get_index(entity);
+
+			if (!m_valid || index >= m_positions.size()) {
+				return INVALID_POSITION;
+			}
+
+			const auto position = m_positions[index];
+
+			return position < m_nodes.size() && m_nodes[position].entity == entity ? position
+					: INVALID_POSITION;
+		}
+
+		// Descendants of instance in pre-order, returns false if the cache does not cover it
+		bool find_descendants(const Instance&, std::span<const Node>& result) const;
+
+		// Positions of the descendants of instance whose class is exactly classID, in pre-order.
+		// Returns false if the cache does not cover instance.
+		bool find_descendants_of_class(const Instance&, InstanceClass classID,
+				std::span<const uint32_t>& result) const;
+
+		// Whether entity is ancestor or one of its descendants, returns false if the cache does
+		// not cover both
+		bool find_in_subtree(ECS::Entity ancestor, ECS::Entity entity, bool& result) const {
+			const auto ancestorPos = find_position(ancestor);
+			const auto entityPos = find_position(entity);
+
+			if (ancestorPos == INVALID_POSITION || entityPos == INVALID_POSITION) {
+				return false;
+			}
+
+			result = entityPos >= ancestorPos
+					&& entityPos < ancestorPos + m_nodes[ancestorPos].subtreeSize;
+			return true;
+		}
+
+		const Node& get_node(uint32_t position) const {
+			return m_nodes[position];
+		}
+
+		std::span<const Node> get_nodes() const {
+			return m_nodes;
+		}
+	private:
+		std::vector<Node> m_nodes;
+		// Position of each node by entity index
+		std::vector<uint32_t> m_positions;
+		// Positions of the nodes of each class in increasing order, so the nodes of a class
+		// within a subtree are a contiguous range
+		std::vector<uint32_t> m_classPositions[static_cast<uint32_t>(InstanceClass::NUM_CLASSES)];
+		uint64_t m_generation = 0;
+		uint64_t m_nameGeneration = 0;
+		bool m_valid = false;
+
+		void append_tree(ECS::Manager&, ECS::Entity rootEntity, Instance& root);
+		void append_node(ECS::Entity, Instance&, uint32_t depth, uint32_t parentPosition);
+};
+
+}
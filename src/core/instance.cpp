@@ -2,15 +2,33 @@
 
 #include <ecs/ecs.hpp>
 
+#include <core/hierarchy_cache.hpp>
 #include <core/instance_utils.hpp>
-#include <core/ancestry_changed_callbacks.hpp>
+#include <core/ancestry_change_queue.hpp>
 #include <core/destroyed_callbacks.hpp>
 
+#include <unordered_map>
+
 using namespace Game;
 
-static void dispatch_ancestry_change(ECS::Manager& ecs, Instance& selfInst, ECS::Entity selfEntity,
-		Instance* oldParentInst, ECS::Entity oldParentEntity, Instance* newParentInst,
-		ECS::Entity newParentEntity);
+namespace {
+
+// First child with each name, kept by parents with many children
+struct ChildNameIndex {
+	std::unordered_map<Atom, ECS::Entity, Atom::Hash> children;
+};
+
+}
+
+static ChildNameIndex* get_child_name_index(ECS::Manager& ecs, ECS::Entity parentEntity);
+static ECS::Entity find_child_linear(ECS::Manager& ecs, const Instance& parent, Atom name,
+		ECS::Entity skipEntity);
+static void unindex_child(ECS::Manager& ecs, ChildNameIndex& index, const Instance& parent,
+		Atom name, ECS::Entity childEntity);
+static void build_child_name_index(ECS::Manager& ecs, const Instance& parent,
+		ECS::Entity parentEntity);
+
+static void unlink_from_parent(ECS::Manager& ecs, Instance& inst, ECS::Entity entity);
 
 void Game::Instance::set_parent(ECS::Manager& ecs, ECS::Entity newParentEntity,
 		ECS::Entity selfEntity) {
@@ -18,71 +36,147 @@ void Game::Instance::set_parent(ECS::Manager& ecs, ECS::Entity newParentEntity,
 		return;
 	}
 
-	auto oldParentEntity = m_parent;
+	unlink_from_parent(ecs, *this, selfEntity);
 	m_parent = newParentEntity;
 
-	Instance* oldParent = nullptr;
-	Instance* newParent = nullptr;
-
-	if (m_lastChild != ECS::INVALID_ENTITY) {
-		auto& lastChildInstance = ecs.get_component<Instance>(m_lastChild);
-		lastChildInstance.m_nextChild = m_nextChild;
-	}
-
-	if (oldParentEntity != ECS::INVALID_ENTITY) {
-		auto& oldParentInstance = ecs.get_component<Instance>(oldParentEntity);
-		oldParent = &oldParentInstance;
-
-		if (oldParentInstance.m_firstChild == selfEntity) {
-			oldParentInstance.m_firstChild = m_nextChild;
-		}
-		if (oldParentInstance.m_lastChild == selfEntity) {
-			oldParentInstance.m_lastChild = m_nextChild;
-		}
-	}
-
 	if (newParentEntity != ECS::INVALID_ENTITY) {
 		auto& parentInstance = ecs.get_component<Instance>(newParentEntity);
-		newParent = &parentInstance;
 
 		if (parentInstance.m_lastChild != ECS::INVALID_ENTITY) {
 			auto& lastChild = ecs.get_component<Instance>(parentInstance.m_lastChild);
 			lastChild.m_nextChild = selfEntity;
+			m_prevChild = parentInstance.m_lastChild;
 		}
 		else {
 			parentInstance.m_firstChild = selfEntity;
 		}
 
-		m_nextChild = ECS::INVALID_ENTITY;
 		parentInstance.m_lastChild = selfEntity;
+		++parentInstance.m_numChildren;
+
+		// The instance is the last child, so an existing entry for its name comes first
+		if (auto* pIndex = get_child_name_index(ecs, newParentEntity); pIndex) {
+			pIndex->children.try_emplace(m_name, selfEntity);
+		}
+		else if (parentInstance.m_numChildren >= CHILD_NAME_INDEX_THRESHOLD) {
+			build_child_name_index(ecs, parentInstance, newParentEntity);
+		}
+	}
+
+	ecs.get_context<HierarchyCache>().invalidate();
+
+	// Ancestry changed callbacks run at the next flush
+	ecs.get_context<AncestryChangeQueue>().push(selfEntity);
+}
+
+void Game::Instance::set_name(ECS::Manager& ecs, ECS::Entity selfEntity, Atom name) {
+	if (name == m_name) {
+		return;
+	}
+
+	const Atom oldName = m_name;
+	m_name = name;
+
+	ecs.get_context<HierarchyCache>().note_renamed();
+
+	if (auto* pIndex = m_parent != ECS::INVALID_ENTITY ? get_child_name_index(ecs, m_parent)
+			: nullptr; pIndex) {
+		auto& parent = ecs.get_component<Instance>(m_parent);
+		unindex_child(ecs, *pIndex, parent, oldName, selfEntity);
+
+		// An earlier sibling may already have the new name
+		pIndex->children[name] = find_child_linear(ecs, parent, name, ECS::INVALID_ENTITY);
+	}
+}
+
+// Marks the instance destroyed and runs its destroyed callback, returns false if it already was
+static bool begin_destroy(ECS::Manager& ecs, Instance& inst, ECS::Entity entity) {
+	if (inst.m_destroyed) {
+		return false;
+	}
+
+	inst.m_destroyed = true;
+
+	if (auto callback = Game::destroyedCallbacks[static_cast<uint32_t>(inst.m_classID)]; callback) {
+		callback(ecs, inst, entity);
 	}
 
-	dispatch_ancestry_change(ecs, *this, selfEntity, oldParent, oldParentEntity, newParent,
-			newParentEntity);
+	return true;
 }
 
 void Game::Instance::destroy(ECS::Manager& ecs, ECS::Entity selfEntity) {
+	if (begin_destroy(ecs, *this, selfEntity)) {
+		unlink_from_parent(ecs, *this, selfEntity);
+		ecs.get_context<HierarchyCache>().invalidate();
+		ecs.destroy_entity(selfEntity);
+	}
+}
+
+void Game::Instance::destroy_subtree(ECS::Manager& ecs, ECS::Entity selfEntity) {
 	if (m_destroyed) {
 		return;
 	}
 
-	m_destroyed = true;
+	std::vector<ECS::Entity> entities;
+	entities.push_back(selfEntity);
+
+	Game::for_each_descendant(ecs, *this, [&](auto entity, auto&) {
+		entities.push_back(entity);
+	});
+
+	// Every callback runs before anything is destroyed, so callbacks may still access the rest of
+	// the subtree
+	size_t numEntities = 0;
+
+	for (auto entity : entities) {
+		if (begin_destroy(ecs, ecs.get_component<Instance>(entity), entity)) {
+			entities[numEntities++] = entity;
+		}
+	}
+
+	entities.resize(numEntities);
 
-	if (auto callback = Game::destroyedCallbacks[static_cast<uint32_t>(m_classID)]; callback) {
-		callback(ecs, *this, selfEntity);
+	if (!entities.empty() && entities.front() == selfEntity) {
+		unlink_from_parent(ecs, *this, selfEntity);
 	}
 
-	ecs.destroy_entity(selfEntity);
+	ecs.get_context<HierarchyCache>().invalidate();
+	ecs.destroy_entities(entities);
 }
 
+// Short child lists compare the strings, which avoids looking the name up in the atom table
 ECS::Entity Game::Instance::find_first_child(ECS::Manager& ecs,
 		const std::string_view& name) const {
-	auto nextEntity = m_firstChild;
+	if (m_firstChild == ECS::INVALID_ENTITY) {
+		return ECS::INVALID_ENTITY;
+	}
 
-	while (nextEntity != ECS::INVALID_ENTITY) {
+	const auto selfEntity = ecs.get_component<Instance>(m_firstChild).m_parent;
+
+	if (auto* pIndex = get_child_name_index(ecs, selfEntity); pIndex) {
+		// A name that was never interned is not the name of any instance
+		Atom atom;
+
+		if (!Atom::find(name, atom)) {
+			return ECS::INVALID_ENTITY;
+		}
+
+		auto it = pIndex->children.find(atom);
+
+		if (it == pIndex->children.end()) {
+			return ECS::INVALID_ENTITY;
+		}
+		else if (ecs.is_valid_entity(it->second)) {
+			return it->second;
+		}
+
+		// A child was destroyed without being unparented, the children are walked instead
+	}
+
+	for (auto nextEntity = m_firstChild; nextEntity != ECS::INVALID_ENTITY;) {
 		auto& child = ecs.get_component<Instance>(nextEntity);
 
-		if (name.compare(child.m_name) == 0) {
+		if (child.m_name.get_string() == name) {
 			return nextEntity;
 		}
 
@@ -114,10 +208,10 @@ std::string_view Game::Instance::get_class_name() const {
 }
 
 std::string Game::Instance::get_full_name(ECS::Manager& ecs) {
-	std::string result = m_name;
+	std::string result = m_name.get_string();
 
 	Game::for_each_ancestor(ecs, *this, [&](auto, auto& inst) {
-		result = inst.m_name + "." + result;
+		result = inst.m_name.get_string() + "." + result;
 	});
 
 	return result;
@@ -128,6 +222,16 @@ bool Game::Instance::is_a(Game::InstanceClass id) const {
 }
 
 bool Game::Instance::is_descendant_of(ECS::Manager& ecs, ECS::Entity ancestor) const {
+	if (m_parent == ECS::INVALID_ENTITY) {
+		return false;
+	}
+
+	// Being a descendant of ancestor means having a parent in its subtree
+	if (bool result; ecs.get_context<HierarchyCache>().find_in_subtree(ancestor, m_parent,
+			result)) {
+		return result;
+	}
+
 	auto parentEntity = m_parent;
 
 	while (parentEntity != ECS::INVALID_ENTITY) {
@@ -149,12 +253,18 @@ bool Game::Instance::is_ancestor_of(ECS::Manager& ecs, ECS::Entity selfEntity,
 
 ECS::Entity Game::Instance::find_first_ancestor(ECS::Manager& ecs,
 		const std::string_view& name) const {
+	Atom atom;
+
+	if (!Atom::find(name, atom)) {
+		return ECS::INVALID_ENTITY;
+	}
+
 	auto parentEntity = m_parent;
 
 	while (parentEntity != ECS::INVALID_ENTITY) {
 		auto& parent = ecs.get_component<Game::Instance>(parentEntity);
 
-		if (name.compare(parent.m_name) == 0) {
+		if (parent.m_name == atom) {
 			return parentEntity;
 		}
 
@@ -198,89 +308,88 @@ ECS::Entity Game::Instance::find_first_ancestor_which_is_a(ECS::Manager& ecs,
 	return ECS::INVALID_ENTITY;
 }
 
-//#include <core/logging.hpp>
-
-static void dispatch_ancestry_change(ECS::Manager& ecs, Instance& selfInst, ECS::Entity selfEntity,
-		Instance* oldParentInst, ECS::Entity oldParentEntity, Instance* newParentInst,
-		ECS::Entity newParentEntity) {
-	(void)oldParentInst;
-	(void)oldParentEntity;
-
-	/*if (oldParentInst) {
-		LOG_TEMP("%s.ChildRemoved(%s)", oldParentInst->get_full_name(ecs).c_str(),
-				selfInst.get_full_name(ecs).c_str());
-
-		if (!selfInst.is_descendant_of(ecs, oldParentEntity)) {
-			for_each_descendant(ecs, selfInst, [&](auto, auto& desc) {
-				LOG_TEMP("%s.DescendantRemoving(%s)", oldParentInst->get_full_name(ecs).c_str(),
-						desc.get_full_name(ecs).c_str());
-			});
-
-			for_each_ancestor(ecs, *oldParentInst, [&](auto, auto& ancestor) {
-				LOG_TEMP("%s.DescendantRemoving(%s)", ancestor.get_full_name(ecs).c_str(),
-						selfInst.get_full_name(ecs).c_str());
-
-				for_each_descendant(ecs, selfInst, [&](auto, auto& desc) {
-					LOG_TEMP("%s.DescendantRemoving(%s)",
-							ancestor.get_full_name(ecs).c_str(),
-							desc.get_full_name(ecs).c_str());
-				});
-			});
+static ChildNameIndex* get_child_name_index(ECS::Manager& ecs, ECS::Entity parentEntity) {
+	return ecs.has_component<ChildNameIndex>(parentEntity)
+			? &ecs.get_component<ChildNameIndex>(parentEntity) : nullptr;
+}
+
+static ECS::Entity find_child_linear(ECS::Manager& ecs, const Instance& parent, Atom name,
+		ECS::Entity skipEntity) {
+	for (auto nextEntity = parent.m_firstChild; nextEntity != ECS::INVALID_ENTITY;) {
+		auto& child = ecs.get_component<Instance>(nextEntity);
+
+		if (child.m_name == name && nextEntity != skipEntity) {
+			return nextEntity;
 		}
+
+		nextEntity = child.m_nextChild;
 	}
 
-	if (newParentInst) {
-		LOG_TEMP("%s.DescendantAdded(%s)", newParentInst->get_full_name(ecs).c_str(),
-				selfInst.get_full_name(ecs).c_str());
+	return ECS::INVALID_ENTITY;
+}
+
+// Points the entry for name at the next child with that name if it was childEntity
+static void unindex_child(ECS::Manager& ecs, ChildNameIndex& index, const Instance& parent,
+		Atom name, ECS::Entity childEntity) {
+	auto it = index.children.find(name);
 
-		if (!(oldParentInst && oldParentInst->is_descendant_of(ecs, newParentEntity))) {
-			for_each_descendant(ecs, selfInst, [&](auto, auto& desc) {
-				LOG_TEMP("%s.DescendantAdded(%s)", newParentInst->get_full_name(ecs).c_str(),
-						desc.get_full_name(ecs).c_str());
-			});
+	if (it == index.children.end() || it->second != childEntity) {
+		return;
+	}
 
-			for_each_ancestor_cond(ecs, *newParentInst, [&](auto ancEntity, auto& ancestor) {
-				if (oldParentEntity == ancEntity
-						|| (oldParentInst && oldParentInst->is_descendant_of(ecs, ancEntity))) {
-					return IterationDecision::BREAK;
-				}
+	if (auto nextEntity = find_child_linear(ecs, parent, name, childEntity);
+			nextEntity != ECS::INVALID_ENTITY) {
+		it->second = nextEntity;
+	}
+	else {
+		index.children.erase(it);
+	}
+}
 
-				LOG_TEMP("%s.DescendantAdded(%s)", ancestor.get_full_name(ecs).c_str(),
-						selfInst.get_full_name(ecs).c_str());
+static void build_child_name_index(ECS::Manager& ecs, const Instance& parent,
+		ECS::Entity parentEntity) {
+	auto& index = ecs.add_component<ChildNameIndex>(parentEntity);
 
-				for_each_descendant(ecs, selfInst, [&](auto, auto& desc) {
-					LOG_TEMP("%s.DescendantAdded(%s)", ancestor.get_full_name(ecs).c_str(),
-							desc.get_full_name(ecs).c_str());
-				});
+	for (auto nextEntity = parent.m_firstChild; nextEntity != ECS::INVALID_ENTITY;) {
+		auto& child = ecs.get_component<Instance>(nextEntity);
+		index.children.try_emplace(child.m_name, nextEntity);
+		nextEntity = child.m_nextChild;
+	}
+}
 
-				return IterationDecision::CONTINUE;
-			});
-		}
+// Removes the instance from its parent's children, keeping m_parent
+static void unlink_from_parent(ECS::Manager& ecs, Instance& inst, ECS::Entity entity) {
+	if (inst.m_parent == ECS::INVALID_ENTITY) {
+		return;
+	}
 
-		LOG_TEMP("%s.ChildAdded(%s)", newParentInst->get_full_name(ecs).c_str(),
-				selfInst.get_full_name(ecs).c_str());
-	}*/
+	auto& parent = ecs.get_component<Instance>(inst.m_parent);
 
-	if (auto callback = ancestryChangedCallbacks[static_cast<uint32_t>(selfInst.m_classID)];
-			callback) {
-		callback(ecs, selfInst, selfEntity, newParentInst, newParentEntity);
+	if (inst.m_prevChild != ECS::INVALID_ENTITY) {
+		ecs.get_component<Instance>(inst.m_prevChild).m_nextChild = inst.m_nextChild;
+	}
+	else {
+		parent.m_firstChild = inst.m_nextChild;
 	}
 
-	for_each_descendant(ecs, selfInst, [&](auto childEntity, auto& child) {
-		if (auto callback = ancestryChangedCallbacks[static_cast<uint32_t>(child.m_classID)];
-				callback) {
-			callback(ecs, child, childEntity, newParentInst, newParentEntity);
-		}
-	});
+	if (inst.m_nextChild != ECS::INVALID_ENTITY) {
+		ecs.get_component<Instance>(inst.m_nextChild).m_prevChild = inst.m_prevChild;
+	}
+	else {
+		parent.m_lastChild = inst.m_prevChild;
+	}
 
-	/*LOG_TEMP("%s.AncestryChanged(child: %s, parent: %s)", selfInst.get_full_name(ecs).c_str(),
-			selfInst.get_full_name(ecs).c_str(),
-			newParentInst ? newParentInst->get_full_name(ecs).c_str() : "nil");
+	inst.m_prevChild = ECS::INVALID_ENTITY;
+	inst.m_nextChild = ECS::INVALID_ENTITY;
+	--parent.m_numChildren;
 
-	for_each_descendant(ecs, selfInst, [&](auto, auto& child) {
-		LOG_TEMP("%s.AncestryChanged(child: %s, parent: %s)", child.get_full_name(ecs).c_str(),
-				selfInst.get_full_name(ecs).c_str(),
-				newParentInst ? newParentInst->get_full_name(ecs).c_str() : "nil");
-	});*/
+	// Dropped at half the threshold, so a parent around it does not rebuild on every reparent
+	if (auto* pIndex = get_child_name_index(ecs, inst.m_parent); pIndex) {
+		if (parent.m_numChildren < Instance::CHILD_NAME_INDEX_THRESHOLD / 2) {
+			ecs.remove_component<ChildNameIndex>(inst.m_parent);
+		}
+		else {
+			unindex_child(ecs, *pIndex, parent, inst.m_name, entity);
+		}
+	}
 }
-
@@ -2,6 +2,7 @@
 
 #include <ecs/ecs_fwd.hpp>
 
+#include <core/atom.hpp>
 #include <core/instance_class.hpp>
 
 #include <string>
@@ -9,19 +10,30 @@
 namespace Game {
 
 struct Instance {
+	static constexpr size_t CHILD_NAME_INDEX_THRESHOLD = 16;
+
 	ECS::Entity m_parent = ECS::INVALID_ENTITY;
 	ECS::Entity m_firstChild = ECS::INVALID_ENTITY;
 	ECS::Entity m_lastChild = ECS::INVALID_ENTITY;
 	ECS::Entity m_nextChild = ECS::INVALID_ENTITY;
 	ECS::Entity m_prevChild = ECS::INVALID_ENTITY;
-	std::string m_name;
+	// Maintained by set_parent, decides when the child name index is kept
+	uint32_t m_numChildren = 0;
+	// Assign directly only before the instance is parented, set_name keeps the parent's child
+	// name index up to date
+	Atom m_name;
 	InstanceClass m_classID;
 	// FIXME: the only property missing is bool m_archivable;
 	bool m_destroyed;
 
 	void set_parent(ECS::Manager&, ECS::Entity parent, ECS::Entity selfEntity);
+	void set_name(ECS::Manager&, ECS::Entity selfEntity, Atom name);
 	void destroy(ECS::Manager&, ECS::Entity selfEntity);
+	// Destroys the instance and all of its descendants in one batch
+	void destroy_subtree(ECS::Manager&, ECS::Entity selfEntity);
 
+	// Parents keep a name index from CHILD_NAME_INDEX_THRESHOLD children until they drop below
+	// half of that. It is only changed by reparenting, so lookups are read only.
 	ECS::Entity find_first_child(ECS::Manager&, const std::string_view& name) const;
 	ECS::Entity find_first_child_of_class(ECS::Manager&, InstanceClass) const;
 
@@ -40,3 +52,8 @@ struct Instance {
 
 }
 
+// Instances are held by pointer across component adds, so they are stored in pages that never move
+template <>
+struct ECS::ComponentStorageTraits<Game::Instance> {
+	static constexpr bool PAGED = true;
+};
@@ -4,10 +4,21 @@
 #include <ui/ui_components.hpp>
 #include <core/instance_utils.hpp>
 
+#include <animation/rig_component.hpp>
+
 #include <ecs/ecs.hpp>
 
+#include <unordered_map>
+#include <vector>
+
 using namespace Game;
 
+using EntityMap = std::unordered_map<ECS::Entity, ECS::Entity>;
+
+static bool can_clone(InstanceClass);
+static void clone_components(ECS::Manager&, InstanceClass, ECS::Entity prototype,
+		ECS::Entity entity, const EntityMap& clones, const EntityMap& rigs);
+
 Instance* Game::InstanceFactory::create(ECS::Manager& ecs, InstanceClass id, ECS::Entity& entity) {
 	entity = ecs.create_entity();
 
@@ -89,3 +100,136 @@ Instance* Game::InstanceFactory::create(ECS::Manager& ecs, InstanceClass id, ECS
 	return &result;
 }
 
+
+Instance* Game::InstanceFactory::instantiate(ECS::Manager& ecs, ECS::Entity prototype,
+		ECS::Entity& outEntity) {
+	outEntity = ECS::INVALID_ENTITY;
+
+	auto& protoRoot = ecs.get_component<Instance>(prototype);
+	bool clonable = can_clone(protoRoot.m_classID);
+
+	// FIXME: frame memory
+	std::vector<ECS::Entity> prototypes;
+	prototypes.push_back(prototype);
+
+	for_each_descendant(ecs, protoRoot, [&](auto entity, auto& desc) {
+		prototypes.push_back(entity);
+		clonable = clonable && can_clone(desc.m_classID);
+	});
+
+	if (!clonable) {
+		return nullptr;
+	}
+
+	EntityMap clones;
+
+	for (auto entity : prototypes) {
+		clones.emplace(entity, ecs.create_entity());
+	}
+
+	// Rigs posed by a model of the prototype get their own bone transforms, sharing the Rig
+	EntityMap rigs;
+
+	ecs.get_view<RigComponent>().for_each([&](auto eRig, auto& rc) {
+		if (clones.contains(rc.m_rigContainer)) {
+			rigs.emplace(eRig, ECS::INVALID_ENTITY);
+		}
+	});
+
+	for (auto& [eProtoRig, eRig] : rigs) {
+		auto& protoRig = ecs.get_component<RigComponent>(eProtoRig);
+		auto rig = protoRig.m_rig;
+		auto eContainer = clones.at(protoRig.m_rigContainer);
+
+		eRig = ecs.create_entity();
+		ecs.add_component<RigComponent>(eRig, std::move(rig), eContainer);
+	}
+
+	// Prototypes are in pre-order, so each parent exists before its children are attached
+	for (auto eProto : prototypes) {
+		auto entity = clones.at(eProto);
+		auto& proto = ecs.get_component<Instance>(eProto);
+
+		clone_components(ecs, proto.m_classID, eProto, entity, clones, rigs);
+
+		auto& inst = ecs.add_component<Instance>(entity);
+		inst.m_classID = proto.m_classID;
+		inst.m_name = proto.m_name;
+		inst.m_destroyed = false;
+
+		if (eProto != prototype) {
+			inst.set_parent(ecs, clones.at(proto.m_parent), entity);
+		}
+	}
+
+	outEntity = clones.at(prototype);
+	return &ecs.get_component<Instance>(outEntity);
+}
+
+// Classes whose components are copied by clone_components, or that have none
+static bool can_clone(InstanceClass id) {
+	switch (id) {
+		case InstanceClass::INSTANCE:
+		case InstanceClass::CUBE_GEOM:
+		case InstanceClass::SLOPE_GEOM:
+		case InstanceClass::CORNER_SLOPE_GEOM:
+		case InstanceClass::SPAWN_LOCATION:
+		case InstanceClass::MESH_GEOM:
+		case InstanceClass::MODEL:
+		case InstanceClass::ATTACHMENT:
+		case InstanceClass::BONE:
+		case InstanceClass::ANIMATION_CONTROLLER:
+		case InstanceClass::ANIMATION:
+			return true;
+		default:
+			return false;
+	}
+}
+
+// Entities outside of the subtree are kept as they are
+static ECS::Entity remap(const EntityMap& map, ECS::Entity entity) {
+	auto it = map.find(entity);
+	return it != map.end() ? it->second : entity;
+}
+
+template <typename Component>
+static Component& copy_component(ECS::Manager& ecs, ECS::Entity prototype, ECS::Entity entity) {
+	auto& component = ecs.add_component<Component>(entity);
+	// Fetched after adding, which may move the components of the pool
+	component = ecs.get_component<Component>(prototype);
+	return component;
+}
+
+static void clone_components(ECS::Manager& ecs, InstanceClass id, ECS::Entity prototype,
+		ECS::Entity entity, const EntityMap& clones, const EntityMap& rigs) {
+	switch (id) {
+		case InstanceClass::CUBE_GEOM:
+		case InstanceClass::SLOPE_GEOM:
+		case InstanceClass::CORNER_SLOPE_GEOM:
+		case InstanceClass::SPAWN_LOCATION:
+			Geometry::clone(ecs, prototype, entity);
+			break;
+		case InstanceClass::MESH_GEOM:
+			MeshGeom::clone(ecs, prototype, entity,
+					remap(rigs, ecs.get_component<MeshGeom>(prototype).get_rig()));
+			break;
+		case InstanceClass::MODEL:
+		{
+			auto& model = copy_component<Model>(ecs, prototype, entity);
+			model.set_primary_part(remap(clones, model.get_primary_part()));
+		}
+			break;
+		// World transforms copied from the prototype are placed relative to its ancestors
+		case InstanceClass::ATTACHMENT:
+			copy_component<Attachment>(ecs, prototype, entity).mark_world_dirty();
+			break;
+		case InstanceClass::BONE:
+			copy_component<BoneAttachment>(ecs, prototype, entity).mark_world_dirty();
+			break;
+		case InstanceClass::ANIMATION_CONTROLLER:
+			copy_component<Animator>(ecs, prototype, entity);
+			break;
+		default:
+			break;
+	}
+}
@@ -6,5 +6,10 @@ namespace Game::InstanceFactory {
 
 Instance* create(ECS::Manager& ecs, InstanceClass classID, ECS::Entity& outEntity);
 
+// Copies the subtree of prototype without a parent. Meshes, rigs, textures and animations are
+// shared with the prototype, so nothing is reloaded. Returns nullptr if the subtree has an
+// instance whose class cannot be cloned.
+Instance* instantiate(ECS::Manager& ecs, ECS::Entity prototype, ECS::Entity& outEntity);
+
 }
 
@@ -4,12 +4,20 @@
 
 #include <ecs/ecs.hpp>
 
+#include <core/hierarchy_cache.hpp>
 #include <core/instance.hpp>
 
+#include <span>
 #include <string_view>
+#include <utility>
 
 namespace Game {
 
+InstanceClass get_instance_class_id_by_name(const std::string_view& name);
+std::string_view get_instance_class_name(InstanceClass);
+bool instance_class_is_a(InstanceClass childToTest, InstanceClass baseClass);
+bool instance_class_is_creatable(InstanceClass);
+
 template <typename Functor>
 inline void for_each_child(ECS::Manager& ecs, Instance& instance, Functor&& func) {
 	auto nextEntity = instance.m_firstChild;
@@ -38,16 +46,108 @@ inline void for_each_child_cond(ECS::Manager& ecs, Instance& instance, Functor&&
 	}
 }
 
+// Visits the descendants in pre-order, as a scan of the hierarchy cache unless it is stale
 template <typename Functor>
 inline void for_each_descendant(ECS::Manager& ecs, Instance& instance, Functor&& func) {
+	if (instance.m_firstChild == ECS::INVALID_ENTITY) {
+		return;
+	}
+
+	if (std::span<const HierarchyCache::Node> descendants;
+			ecs.get_context<HierarchyCache>().find_descendants(instance, descendants)) {
+		for (auto& node : descendants) {
+			func(node.entity, *node.instance);
+		}
+
+		return;
+	}
+
 	for_each_child(ecs, instance, [&](auto entity, auto& child) {
 		func(entity, child);
 		for_each_descendant(ecs, child, func);
 	});
 }
 
+// Visits the descendants whose class is exactly classID. Reads the cache's list for that class
+// unless it is stale.
+template <typename Functor>
+inline void for_each_descendant_of_class(ECS::Manager& ecs, Instance& instance,
+		InstanceClass classID, Functor&& func) {
+	auto& cache = ecs.get_context<HierarchyCache>();
+
+	if (std::span<const uint32_t> positions;
+			cache.find_descendants_of_class(instance, classID, positions)) {
+		for (auto position : positions) {
+			auto& node = cache.get_node(position);
+			func(node.entity, *node.instance);
+		}
+
+		return;
+	}
+
+	for_each_descendant(ecs, instance, [&](auto entity, auto& desc) {
+		if (desc.m_classID == classID) {
+			func(entity, desc);
+		}
+	});
+}
+
+// Read only variant for jobs, which must not fetch the cache through the manager themselves
+template <typename Functor>
+inline void for_each_descendant_of_class(const ECS::Manager& ecs, const HierarchyCache& cache,
+		const Instance& instance, InstanceClass classID, Functor&& func) {
+	if (std::span<const uint32_t> positions;
+			cache.find_descendants_of_class(instance, classID, positions)) {
+		for (auto position : positions) {
+			auto& node = cache.get_node(position);
+			func(node.entity, std::as_const(*node.instance));
+		}
+
+		return;
+	}
+
+	for (auto child = instance.m_firstChild; child != ECS::INVALID_ENTITY;) {
+		auto& inst = ecs.get_component<Instance>(child);
+
+		if (inst.m_classID == classID) {
+			func(child, inst);
+		}
+
+		for_each_descendant_of_class(ecs, cache, inst, classID, func);
+		child = inst.m_nextChild;
+	}
+}
+
+// Visits the descendants that are a baseClass, one class at a time
+template <typename Functor>
+inline void for_each_descendant_which_is_a(ECS::Manager& ecs, Instance& instance,
+		InstanceClass baseClass, Functor&& func) {
+	for (uint32_t i = 0; i < static_cast<uint32_t>(InstanceClass::NUM_CLASSES); ++i) {
+		if (instance_class_is_a(static_cast<InstanceClass>(i), baseClass)) {
+			for_each_descendant_of_class(ecs, instance, static_cast<InstanceClass>(i), func);
+		}
+	}
+}
+
 template <typename Functor>
 inline void for_each_ancestor(ECS::Manager& ecs, Instance& instance, Functor&& func) {
+	if (instance.m_parent == ECS::INVALID_ENTITY) {
+		return;
+	}
+
+	auto& cache = ecs.get_context<HierarchyCache>();
+
+	if (auto position = cache.find_position(instance.m_parent);
+			position != HierarchyCache::INVALID_POSITION) {
+		for (; position != HierarchyCache::INVALID_POSITION;
+				position = cache.get_node(position).parentPosition) {
+			auto& node = cache.get_node(position);
+			func(node.entity, *node.instance);
+		}
+
+		return;
+	}
+
 	auto parentEntity = instance.m_parent;
 
 	while (parentEntity != ECS::INVALID_ENTITY) {
@@ -61,6 +161,26 @@ inline void for_each_ancestor(ECS::Manager& ecs, Instance& instance, Functor&& f
 
 template <typename Functor>
 inline void for_each_ancestor_cond(ECS::Manager& ecs, Instance& instance, Functor&& func) {
+	if (instance.m_parent == ECS::INVALID_ENTITY) {
+		return;
+	}
+
+	auto& cache = ecs.get_context<HierarchyCache>();
+
+	if (auto position = cache.find_position(instance.m_parent);
+			position != HierarchyCache::INVALID_POSITION) {
+		for (; position != HierarchyCache::INVALID_POSITION;
+				position = cache.get_node(position).parentPosition) {
+			auto& node = cache.get_node(position);
+
+			if (func(node.entity, *node.instance) == IterationDecision::BREAK) {
+				return;
+			}
+		}
+
+		return;
+	}
+
 	auto parentEntity = instance.m_parent;
 
 	while (parentEntity != ECS::INVALID_ENTITY) {
@@ -74,10 +194,5 @@ inline void for_each_ancestor_cond(ECS::Manager& ecs, Instance& instance, Functo
 	}
 }
 
-InstanceClass get_instance_class_id_by_name(const std::string_view& name);
-std::string_view get_instance_class_name(InstanceClass);
-bool instance_class_is_a(InstanceClass childToTest, InstanceClass baseClass);
-bool instance_class_is_creatable(InstanceClass);
-
 }
 
@@ -0,0 +1,142 @@
+#include "job_system.hpp"
+
+static thread_local uint32_t t_queueIndex = 0;
+
+JobSystem::JobSystem(uint32_t numWorkers) {
+	m_queues.reserve(numWorkers + 1);
+
+	for (uint32_t i = 0; i <= numWorkers; ++i) {
+		m_queues.emplace_back(std::make_unique<WorkerQueue>());
+	}
+
+	m_workers.reserve(numWorkers);
+
+	for (uint32_t i = 1; i <= numWorkers; ++i) {
+		m_workers.emplace_back([this, i] {
+			worker_main(i);
+		});
+	}
+}
+
+JobSystem::~JobSystem() {
+	{
+		std::lock_guard lock(m_wakeMutex);
+		m_stopping = true;
+	}
+
+	m_wakeCondition.notify_all();
+
+	for (auto& worker : m_workers) {
+		worker.join();
+	}
+}
+
+void JobSystem::run(Counter& counter, Job job) {
+	counter.m_count.fetch_add(1, std::memory_order_relaxed);
+
+	auto& queue = *m_queues[t_queueIndex];
+
+	{
+		std::lock_guard lock(queue.mutex);
+		queue.jobs.push_back({std::move(job), &counter});
+	}
+
+	{
+		std::lock_guard lock(m_wakeMutex);
+		m_numQueuedJobs.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	m_wakeCondition.notify_one();
+}
+
+void JobSystem::wait(Counter& counter) {
+	QueuedJob job;
+
+	while (!counter.is_done()) {
+		if (try_get_job(t_queueIndex, job)) {
+			execute(job);
+		}
+		else {
+			std::this_thread::yield();
+		}
+	}
+}
+
+uint32_t JobSystem::get_num_workers() const {
+	return static_cast<uint32_t>(m_workers.size());
+}
+
+uint32_t JobSystem::get_default_worker_count() {
+	const auto numThreads = std::thread::hardware_concurrency();
+	return numThreads > 1 ? numThreads - 1 : 0;
+}
+
+void JobSystem::worker_main(uint32_t queueIndex) {
+	t_queueIndex = queueIndex;
+
+	QueuedJob job;
+
+	for (;;) {
+		if (try_get_job(queueIndex, job)) {
+			execute(job);
+			continue;
+		}
+
+		std::unique_lock lock(m_wakeMutex);
+		m_wakeCondition.wait(lock, [this] {
+			return m_stopping || m_numQueuedJobs.load(std::memory_order_relaxed) > 0;
+		});
+
+		if (m_stopping) {
+			return;
+		}
+	}
+}
+
+bool JobSystem::try_pop(uint32_t queueIndex, QueuedJob& job) {
+	auto& queue = *m_queues[queueIndex];
+	std::lock_guard lock(queue.mutex);
+
+	if (queue.jobs.empty()) {
+		return false;
+	}
+
+	job = std::move(queue.jobs.back());
+	queue.jobs.pop_back();
+
+	return true;
+}
+
+bool JobSystem::try_steal(uint32_t thiefIndex, QueuedJob& job) {
+	const auto numQueues = static_cast<uint32_t>(m_queues.size());
+
+	for (uint32_t i = 1; i < numQueues; ++i) {
+		auto& queue = *m_queues[(thiefIndex + i) % numQueues];
+		std::lock_guard lock(queue.mutex);
+
+		if (!queue.jobs.empty()) {
+			job = std::move(queue.jobs.front());
+			queue.jobs.pop_front();
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool JobSystem::try_get_job(uint32_t queueIndex, QueuedJob& job) {
+	if (try_pop(queueIndex, job) || try_steal(queueIndex, job)) {
+		m_numQueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	return false;
+}
+
+void JobSystem::execute(QueuedJob& job) {
+	job.function();
+	job.function = nullptr;
+
+	job.counter->m_count.fetch_sub(1, std::memory_order_release);
+}
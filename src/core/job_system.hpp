@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <core/common.hpp>
+#include <core/local.hpp>
+
+// Work stealing job system. Every worker owns a queue which it pops from the back of, idle workers
+// steal from the front of other workers' queues. Threads that are not workers share queue 0.
+class JobSystem final {
+	public:
+		using Job = std::function<void()>;
+
+		class Counter {
+			public:
+				bool is_done() const {
+					return m_count.load(std::memory_order_acquire) == 0;
+				}
+			private:
+				std::atomic_uint32_t m_count{0};
+
+				friend class JobSystem;
+		};
+
+		// numWorkers excludes the calling thread, which executes jobs while it waits
+		explicit JobSystem(uint32_t numWorkers = get_default_worker_count());
+		~JobSystem();
+
+		NULL_COPY_AND_ASSIGN(JobSystem);
+
+		void run(Counter&, Job);
+
+		// Executes queued jobs on the calling thread until the counter reaches zero
+		void wait(Counter&);
+
+		// Splits [0, count) into ranges of at most chunkSize and calls func(begin, end) for each
+		// range, blocking until all ranges have completed
+		template <typename Functor>
+		void parallel_for(size_t count, size_t chunkSize, Functor&& func) {
+			if (chunkSize == 0) {
+				chunkSize = 1;
+			}
+
+			if (count <= chunkSize || m_workers.empty()) {
+				func(static_cast<size_t>(0), count);
+				return;
+			}
+
+			Counter counter;
+
+			for (size_t begin = chunkSize; begin < count; begin += chunkSize) {
+				const size_t end = begin + chunkSize < count ? begin + chunkSize : count;
+				run(counter, [&func, begin, end] {
+					func(begin, end);
+				});
+			}
+
+			func(static_cast<size_t>(0), chunkSize);
+			wait(counter);
+		}
+
+		uint32_t get_num_workers() const;
+
+		static uint32_t get_default_worker_count();
+	private:
+		struct QueuedJob {
+			Job function;
+			Counter* counter;
+		};
+
+		struct WorkerQueue {
+			std::mutex mutex;
+			std::deque<QueuedJob> jobs;
+		};
+
+		std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+		std::vector<std::thread> m_workers;
+
+		std::mutex m_wakeMutex;
+		std::condition_variable m_wakeCondition;
+		std::atomic_size_t m_numQueuedJobs{0};
+		bool m_stopping = false;
+
+		void worker_main(uint32_t queueIndex);
+
+		bool try_pop(uint32_t queueIndex, QueuedJob& job);
+		bool try_steal(uint32_t thiefIndex, QueuedJob& job);
+		bool try_get_job(uint32_t queueIndex, QueuedJob& job);
+
+		void execute(QueuedJob& job);
+};
+
+inline Local<JobSystem> g_jobSystem;
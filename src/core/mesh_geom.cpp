@@ -17,12 +17,37 @@
 
 using namespace Game;
 
+static uint32_t get_rig_offset(const Memory::SharedPtr<RiggedMesh>& mesh,
+		ECS::Entity selfEntity);
+
 void MeshGeom::create(ECS::Manager& ecs, ECS::Entity entity) {
 	ecs.add_component<MeshGeom>(entity);
 }
 
+void MeshGeom::clone(ECS::Manager& ecs, ECS::Entity prototype, ECS::Entity entity,
+		ECS::Entity eRig) {
+	auto& meshPart = ecs.add_component<MeshGeom>(entity);
+	meshPart = ecs.get_component<MeshGeom>(prototype);
+	meshPart.m_rig = eRig;
+
+	if (!meshPart.is_visible()) {
+		return;
+	}
+
+	auto mesh = Memory::static_pointer_cast<RiggedMesh>(meshPart.m_mesh);
+	const bool opaque = meshPart.m_transparency == 0.f;
+
+	auto& inst = g_riggedMeshRenderer->get_or_add_instance(mesh, opaque, entity);
+	// The prototype is already in the bucket, so getting it does not move inst
+	auto& protoInst = g_riggedMeshRenderer->get_or_add_instance(mesh, opaque, prototype);
+
+	memcpy(&inst, &protoInst, sizeof(MeshGeomInstance));
+	inst.m_indices.rig = get_rig_offset(mesh, entity);
+}
+
 void MeshGeom::set_transform(ECS::Entity selfEntity, Math::Transform transform) {
 	m_transform = std::move(transform);
+	++m_transformVersion;
 
 	if (!is_visible()) {
 		return;
@@ -113,15 +138,12 @@ void MeshGeom::set_rigged_mesh(ECS::Manager& ecs, ECS::Entity selfEntity, std::s
 	auto& rigPool = ecs.get_pool<RigComponent>();
 
 	auto& inst = g_riggedMeshRenderer->get_or_add_instance(mesh, true, selfEntity);
-	RenderKey key{ mesh->get_rig(), mesh };
-	auto& bucket = g_riggedMeshRenderer->get_instances().get_bucket(key);
-	size_t index = bucket.get_sparse_index(selfEntity);
 
 	inst.m_transform = m_transform.scale_by(m_scale);
 	inst.m_reflectance = m_reflectance;
 	inst.m_indices.diffuseTexture = g_riggedMeshRenderer->get_default_diffuse_index();
 	inst.m_indices.normalTexture = g_riggedMeshRenderer->get_default_normal_index();
-	inst.m_indices.rig = static_cast<uint32_t>(index * mesh->get_rig()->get_num_bones());
+	inst.m_indices.rig = get_rig_offset(mesh, selfEntity);
 	//inst.m_indices.rig = static_cast<uint32_t>(rigPool.get_sparse_index(eRig) * mesh->get_rig()->get_num_bones());
 }
 
@@ -150,11 +172,27 @@ void MeshGeom::set_texture(ECS::Entity selfEntity, std::string textureID) {
 	}
 }
 
+ECS::Entity MeshGeom::get_rig() const {
+	return m_rig;
+}
+
 const Math::Transform& MeshGeom::get_transform() const {
 	return m_transform;
 }
 
+uint32_t MeshGeom::get_transform_version() const {
+	return m_transformVersion;
+}
+
 bool MeshGeom::is_visible() const {
 	return m_transparency != 1.f && m_mesh;
 }
 
+static uint32_t get_rig_offset(const Memory::SharedPtr<RiggedMesh>& mesh,
+		ECS::Entity selfEntity) {
+	RenderKey key{ mesh->get_rig(), mesh };
+	auto& bucket = g_riggedMeshRenderer->get_instances().get_bucket(key);
+	size_t index = bucket.get_sparse_index(selfEntity);
+
+	return static_cast<uint32_t>(index * mesh->get_rig()->get_num_bones());
+}
@@ -20,6 +20,10 @@ struct Instance;
 class MeshGeom {
 	public:
 		static void create(ECS::Manager&, ECS::Entity);
+		// Adds a copy of the mesh geom of prototype to entity, sharing its mesh and textures and
+		// drawn with rig
+		static void clone(ECS::Manager&, ECS::Entity prototype, ECS::Entity entity,
+				ECS::Entity rig);
 		static void on_destroyed(ECS::Manager&, Instance&, ECS::Entity);
 		static void on_ancestry_changed(ECS::Manager&, Instance&, ECS::Entity, Instance*,
 				ECS::Entity);
@@ -34,7 +38,11 @@ class MeshGeom {
 				Memory::SharedPtr<RiggedMesh>, ECS::Entity rig);
 		void set_texture(ECS::Entity selfEntity, std::string textureID);
 
+		ECS::Entity get_rig() const;
+
 		const Math::Transform& get_transform() const;
+		// Changes whenever the transform is set
+		uint32_t get_transform_version() const;
 		const Math::Vector3& get_size() const;
 		Math::Color3uint8 get_color() const;
 		
@@ -44,6 +52,7 @@ class MeshGeom {
 		bool is_visible() const;
 	private:
 		Math::Transform m_transform;
+		uint32_t m_transformVersion = 0;
 		Math::Vector3 m_size;
 		Math::Vector3 m_originalSize;
 		Math::Vector3 m_scale;
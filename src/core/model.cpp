@@ -1,24 +1,29 @@
 #include "model.hpp"
-#include "glm/gtx/string_cast.hpp"
-#include <unordered_map>
-
-#include <core/pair.hpp>
 
 #include <ecs/ecs.hpp>
 
 #include <core/instance.hpp>
 #include <core/instance_utils.hpp>
+#include <core/hierarchy_cache.hpp>
 #include <core/geom.hpp>
 #include <core/mesh_geom.hpp>
 
 using namespace Game;
 
+template <typename Geom>
+static void move_part(Geom& geom, ECS::Entity entity, Math::Transform transform,
+		uint32_t& transformVersion) {
+	geom.set_transform(entity, std::move(transform));
+	transformVersion = geom.get_transform_version();
+}
+
 void Model::create(ECS::Manager& ecs, ECS::Entity entity) {
 	ecs.add_component<Model>(entity);
 }
 
 void Model::set_primary_part(ECS::Entity entity) {
 	m_primaryPart = entity;
+	m_assemblyValid = false;
 }
 
 void Model::set_primary_geom_transform(ECS::Manager& ecs, Instance& selfInstance,
@@ -27,51 +32,82 @@ void Model::set_primary_geom_transform(ECS::Manager& ecs, Instance& selfInstance
 		return;
 	}
 
-	// FIXME: frame memory
-	std::unordered_map<Geometry*, Pair<ECS::Entity, Math::Transform>> parts;
-	std::unordered_map<MeshGeom*, Pair<ECS::Entity, Math::Transform>> meshParts;
+	if (!is_assembly_valid(ecs)) {
+		build_assembly(ecs, selfInstance);
+	}
+
+	for (auto& part : m_assembly) {
+		if (part.isMesh) {
+			move_part(ecs.get_component<MeshGeom>(part.entity), part.entity,
+					transform * part.offset, part.transformVersion);
+		}
+		else {
+			move_part(ecs.get_component<Geometry>(part.entity), part.entity,
+					transform * part.offset, part.transformVersion);
+		}
+	}
+}
+
+ECS::Entity Model::get_primary_part() const {
+	return m_primaryPart;
+}
 
+bool Model::is_assembly_valid(ECS::Manager& ecs) const {
+	if (!m_assemblyValid
+			|| m_assemblyGeneration != ecs.get_context<HierarchyCache>().get_generation()) {
+		return false;
+	}
+
+	for (auto& part : m_assembly) {
+		const auto version = part.isMesh
+				? ecs.get_component<MeshGeom>(part.entity).get_transform_version()
+				: ecs.get_component<Geometry>(part.entity).get_transform_version();
+
+		if (version != part.transformVersion) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void Model::build_assembly(ECS::Manager& ecs, Instance& selfInstance) {
 	auto& instPrimaryPart = ecs.get_component<Instance>(m_primaryPart);
+	const bool primaryIsMesh = instPrimaryPart.m_classID == InstanceClass::MESH_GEOM;
 	Math::Transform invPrimaryPartCF;
 
-	if (instPrimaryPart.m_classID == InstanceClass::MESH_GEOM) {
-		invPrimaryPartCF = ecs.get_component<MeshGeom>(m_primaryPart).get_transform().fast_inverse();
+	if (primaryIsMesh) {
+		auto& mp = ecs.get_component<MeshGeom>(m_primaryPart);
+		invPrimaryPartCF = mp.get_transform().fast_inverse();
 	}
 	else {
-		invPrimaryPartCF = ecs.get_component<Geometry>(m_primaryPart).get_transform().fast_inverse();
+		auto& geom = ecs.get_component<Geometry>(m_primaryPart);
+		invPrimaryPartCF = geom.get_transform().fast_inverse();
 	}
-	
-	//printf("invPrimaryPartCF -> %s\n", glm::to_string(invPrimaryPartCF.to_matrix4x4()).data());
-	for_each_descendant(ecs, selfInstance, [&](auto entity, auto& desc) {
+
+	// Keeps its capacity, so rebuilding allocates only when the model gained geoms
+	m_assembly.clear();
+
+	for_each_descendant_which_is_a(ecs, selfInstance, InstanceClass::BASE_GEOM,
+			[&](auto entity, auto& desc) {
+		if (entity == m_primaryPart) {
+			return;
+		}
+
 		if (desc.m_classID == InstanceClass::MESH_GEOM) {
 			auto& mp = ecs.get_component<MeshGeom>(entity);
-			meshParts.emplace(std::make_pair(&mp,
-					Pair{entity, invPrimaryPartCF * mp.get_transform()}));
+			m_assembly.push_back({invPrimaryPartCF * mp.get_transform(), entity,
+					mp.get_transform_version(), true});
 		}
-		else if (desc.is_a(InstanceClass::BASE_GEOM)) {
-			auto& pt = ecs.get_component<Geometry>(entity);
-			parts.emplace(std::make_pair(&pt,
-					Pair{entity, invPrimaryPartCF * pt.get_transform()}));
+		else {
+			auto& geom = ecs.get_component<Geometry>(entity);
+			m_assembly.push_back({invPrimaryPartCF * geom.get_transform(), entity,
+					geom.get_transform_version(), false});
 		}
 	});
 
-	for (auto& [pPart, cfPair] : parts) {
-		pPart->set_transform(cfPair.first, transform * cfPair.second);
-	}
+	m_assembly.push_back({Math::Transform(1.f), m_primaryPart, 0, primaryIsMesh});
 
-	for (auto& [pPart, cfPair] : meshParts) {
-		pPart->set_transform(cfPair.first, transform * cfPair.second);
-	}
-	
-	if (instPrimaryPart.m_classID == InstanceClass::MESH_GEOM) {
-		ecs.get_component<MeshGeom>(m_primaryPart).set_transform(m_primaryPart, transform);
-	}
-	else {
-		ecs.get_component<Geometry>(m_primaryPart).set_transform(m_primaryPart, transform);
-	}
-}
-
-ECS::Entity Model::get_primary_part() const {
-	return m_primaryPart;
+	m_assemblyGeneration = ecs.get_context<HierarchyCache>().get_generation();
+	m_assemblyValid = true;
 }
-
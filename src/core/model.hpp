@@ -1,5 +1,9 @@
 #pragma once
 
+#include <cstdint>
+
+#include <vector>
+
 #include <ecs/ecs_fwd.hpp>
 
 #include <math/transform.hpp>
@@ -18,8 +22,25 @@ class Model {
 
 		ECS::Entity get_primary_part() const;
 	private:
+		// A geom of the model and its transform relative to the primary part
+		struct AssemblyPart {
+			Math::Transform offset;
+			ECS::Entity entity;
+			// Transform version of the geom when it was last set by the model
+			uint32_t transformVersion;
+			bool isMesh;
+		};
+
 		ECS::Entity m_primaryPart = ECS::INVALID_ENTITY;
+
+		// Offsets of every geom are kept between moves, until the hierarchy changes or a geom is
+		// moved by anything but the model. The primary part is last.
+		std::vector<AssemblyPart> m_assembly;
+		uint64_t m_assemblyGeneration = 0;
+		bool m_assemblyValid = false;
+
+		bool is_assembly_valid(ECS::Manager&) const;
+		void build_assembly(ECS::Manager&, Instance& selfInstance);
 };
 
 }
-
@@ -0,0 +1,310 @@
+#include "archetype_storage.hpp"
+
+#include <algorithm>
+
+using namespace ECS;
+
+static constexpr size_t align_up(size_t value, size_t alignment) {
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// Archetype
+
+Archetype::Archetype(std::vector<const ArchetypeComponentInfo*> components)
+		: m_components(std::move(components)) {
+	m_typeIDs.reserve(m_components.size());
+
+	size_t rowSize = sizeof(Entity);
+
+	for (auto* info : m_components) {
+		assert(info->alignment <= CHUNK_ALIGNMENT);
+
+		m_typeIDs.push_back(info->typeID);
+		rowSize += info->size;
+	}
+
+	// Alignment padding may push the estimate over the chunk size, so shrink until it fits.
+	// Components too large for a chunk get chunks holding a single entity.
+	m_chunkCapacity = std::max<size_t>(1, CHUNK_SIZE / rowSize);
+
+	while (m_chunkCapacity > 1 && compute_layout(m_chunkCapacity, m_columnOffsets) > CHUNK_SIZE) {
+		--m_chunkCapacity;
+	}
+
+	m_chunkBytes = align_up(std::max(CHUNK_SIZE, compute_layout(m_chunkCapacity, m_columnOffsets)),
+			CHUNK_ALIGNMENT);
+}
+
+Archetype::~Archetype() {
+	for (size_t row = 0; row < m_size; ++row) {
+		for (size_t column = 0; column < m_components.size(); ++column) {
+			m_components[column]->destroy(get_component(column, row));
+		}
+	}
+}
+
+size_t Archetype::push_back(Entity entity) {
+	if (m_size == m_chunks.size() * m_chunkCapacity) {
+		m_chunks.emplace_back(new (std::align_val_t{CHUNK_ALIGNMENT}) std::byte[m_chunkBytes]);
+	}
+
+	get_entities(m_size / m_chunkCapacity)[m_size % m_chunkCapacity] = entity;
+
+	return m_size++;
+}
+
+Entity Archetype::erase(size_t row) {
+	for (size_t column = 0; column < m_components.size(); ++column) {
+		m_components[column]->destroy(get_component(column, row));
+	}
+
+	return fill_hole(row);
+}
+
+Entity Archetype::move_row_to(size_t row, Archetype& dst, size_t dstRow) {
+	size_t dstColumn = 0;
+
+	// Both type lists are sorted, so matching columns can be found in a single merge pass
+	for (size_t column = 0; column < m_components.size(); ++column) {
+		while (dstColumn < dst.m_typeIDs.size() && dst.m_typeIDs[dstColumn] < m_typeIDs[column]) {
+			++dstColumn;
+		}
+
+		if (dstColumn < dst.m_typeIDs.size() && dst.m_typeIDs[dstColumn] == m_typeIDs[column]) {
+			m_components[column]->relocate(dst.get_component(dstColumn, dstRow),
+					get_component(column, row));
+		}
+		else {
+			m_components[column]->destroy(get_component(column, row));
+		}
+	}
+
+	return fill_hole(row);
+}
+
+void Archetype::swap_rows(size_t i, size_t j) {
+	for (size_t column = 0; column < m_components.size(); ++column) {
+		m_components[column]->swap(get_component(column, i), get_component(column, j));
+	}
+
+	std::swap(get_entities(i / m_chunkCapacity)[i % m_chunkCapacity],
+			get_entities(j / m_chunkCapacity)[j % m_chunkCapacity]);
+}
+
+size_t Archetype::find_column(uint64_t typeID) const {
+	auto it = std::lower_bound(m_typeIDs.begin(), m_typeIDs.end(), typeID);
+
+	if (it == m_typeIDs.end() || *it != typeID) {
+		return INVALID_COLUMN;
+	}
+
+	return static_cast<size_t>(it - m_typeIDs.begin());
+}
+
+bool Archetype::has_type(uint64_t typeID) const {
+	return std::binary_search(m_typeIDs.begin(), m_typeIDs.end(), typeID);
+}
+
+void* Archetype::get_component(size_t column, size_t row) {
+	return m_chunks[row / m_chunkCapacity].get() + m_columnOffsets[column]
+			+ (row % m_chunkCapacity) * m_components[column]->size;
+}
+
+Entity* Archetype::get_entities(size_t chunk) {
+	return reinterpret_cast<Entity*>(m_chunks[chunk].get());
+}
+
+Entity Archetype::get_entity(size_t row) const {
+	return reinterpret_cast<const Entity*>(m_chunks[row / m_chunkCapacity].get())
+			[row % m_chunkCapacity];
+}
+
+const std::vector<const ArchetypeComponentInfo*>& Archetype::get_components() const {
+	return m_components;
+}
+
+const std::vector<uint64_t>& Archetype::get_type_ids() const {
+	return m_typeIDs;
+}
+
+size_t Archetype::size() const {
+	return m_size;
+}
+
+bool Archetype::empty() const {
+	return m_size == 0;
+}
+
+size_t Archetype::get_chunk_capacity() const {
+	return m_chunkCapacity;
+}
+
+size_t Archetype::get_num_chunks() const {
+	return (m_size + m_chunkCapacity - 1) / m_chunkCapacity;
+}
+
+size_t Archetype::get_chunk_size(size_t chunk) const {
+	return std::min(m_chunkCapacity, m_size - chunk * m_chunkCapacity);
+}
+
+Archetype*& Archetype::add_edge(uint64_t typeID) {
+	return m_addEdges[typeID];
+}
+
+Archetype*& Archetype::remove_edge(uint64_t typeID) {
+	return m_removeEdges[typeID];
+}
+
+// Moves the last row into row, whose components must already be destroyed or relocated
+Entity Archetype::fill_hole(size_t row) {
+	const size_t last = --m_size;
+	Entity movedEntity = INVALID_ENTITY;
+
+	if (row != last) {
+		for (size_t column = 0; column < m_components.size(); ++column) {
+			m_components[column]->relocate(get_component(column, row),
+					get_component(column, last));
+		}
+
+		movedEntity = get_entity(last);
+		get_entities(row / m_chunkCapacity)[row % m_chunkCapacity] = movedEntity;
+	}
+
+	// Keep one empty chunk around so entities moving back and forth over a chunk boundary do not
+	// reallocate it every time
+	if (m_chunks.size() > get_num_chunks() + 1) {
+		m_chunks.pop_back();
+	}
+
+	return movedEntity;
+}
+
+size_t Archetype::compute_layout(size_t capacity, std::vector<size_t>& offsets) const {
+	offsets.clear();
+
+	size_t offset = capacity * sizeof(Entity);
+
+	for (auto* info : m_components) {
+		offset = align_up(offset, info->alignment);
+		offsets.push_back(offset);
+		offset += capacity * info->size;
+	}
+
+	return offset;
+}
+
+// ArchetypeManager
+
+ArchetypeManager::ArchetypeManager() {
+	get_or_create_archetype({});
+}
+
+ArchetypeManager::~ArchetypeManager() = default;
+
+Entity ArchetypeManager::create_entity() {
+	Entity entity;
+
+	if (m_freeList == INVALID_ENTITY) {
+		assert(m_entities.size() < INDEX_MASK && "Out of entity indices, see USE_64_BIT_ENTITIES");
+		entity = static_cast<Entity>(m_entities.size());
+		m_entities.push_back(entity);
+		m_locations.emplace_back();
+	}
+	else {
+		entity = make_entity(get_index(m_freeList),
+				get_generation(m_entities[get_index(m_freeList)]));
+		swap_indices(m_entities[get_index(m_freeList)], m_freeList);
+	}
+
+	auto& emptyArchetype = *m_archetypes.front();
+	m_locations[get_index(entity)] = {&emptyArchetype, emptyArchetype.push_back(entity)};
+
+	return entity;
+}
+
+void ArchetypeManager::destroy_entity(Entity entity) {
+	auto& location = m_locations[get_index(entity)];
+
+	if (auto movedEntity = location.archetype->erase(location.row);
+			movedEntity != INVALID_ENTITY) {
+		m_locations[get_index(movedEntity)].row = location.row;
+	}
+
+	location = {};
+
+	increment_generation(m_entities[get_index(entity)]);
+	swap_indices(m_freeList, m_entities[get_index(entity)]);
+}
+
+size_t ArchetypeManager::get_num_archetypes() const {
+	return m_archetypes.size();
+}
+
+Archetype& ArchetypeManager::get_or_create_archetype(
+		std::vector<const ArchetypeComponentInfo*> components) {
+	std::vector<uint64_t> typeIDs;
+	typeIDs.reserve(components.size());
+
+	for (auto* info : components) {
+		typeIDs.push_back(info->typeID);
+	}
+
+	auto& pArchetype = m_archetypeLookup[std::move(typeIDs)];
+
+	if (!pArchetype) {
+		pArchetype = m_archetypes.emplace_back(std::make_unique<Archetype>(
+				std::move(components))).get();
+	}
+
+	return *pArchetype;
+}
+
+Archetype& ArchetypeManager::get_add_target(Archetype& src, const ArchetypeComponentInfo* info) {
+	auto*& pEdge = src.add_edge(info->typeID);
+
+	if (!pEdge) {
+		auto components = src.get_components();
+		components.insert(std::upper_bound(components.begin(), components.end(), info,
+				[](const auto* a, const auto* b) { return a->typeID < b->typeID; }), info);
+
+		pEdge = &get_or_create_archetype(std::move(components));
+		pEdge->remove_edge(info->typeID) = &src;
+	}
+
+	return *pEdge;
+}
+
+Archetype& ArchetypeManager::get_remove_target(Archetype& src,
+		const ArchetypeComponentInfo* info) {
+	auto*& pEdge = src.remove_edge(info->typeID);
+
+	if (!pEdge) {
+		auto components = src.get_components();
+		components.erase(std::find(components.begin(), components.end(), info));
+
+		pEdge = &get_or_create_archetype(std::move(components));
+		pEdge->add_edge(info->typeID) = &src;
+	}
+
+	return *pEdge;
+}
+
+size_t ArchetypeManager::move_entity(Entity entity, Archetype& dst) {
+	auto& location = m_locations[get_index(entity)];
+	const size_t dstRow = dst.push_back(entity);
+
+	if (auto movedEntity = location.archetype->move_row_to(location.row, dst, dstRow);
+			movedEntity != INVALID_ENTITY) {
+		m_locations[get_index(movedEntity)].row = location.row;
+	}
+
+	location = {&dst, dstRow};
+
+	return dstRow;
+}
+
+void ArchetypeManager::update_locations(Archetype& archetype) {
+	for (size_t row = 0; row < archetype.size(); ++row) {
+		m_locations[get_index(archetype.get_entity(row))].row = row;
+	}
+}
@@ -0,0 +1,510 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+
+#include <algorithm>
+#include <array>
+#include <map>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <core/common.hpp>
+#include <core/job_system.hpp>
+
+#include <ecs/ecs_fwd.hpp>
+#include <ecs/component_sort.hpp>
+#include <ecs/type_id_generator.hpp>
+#include <ecs/view.hpp>
+
+// Archetype storage is an opt-in alternative to the sparse set pools of ECS::Manager. Entities with
+// the same set of component types share an Archetype, which stores them in fixed size chunks with
+// one array per component type, so queries stream through contiguous memory. ArchetypeManager
+// mirrors the entity, component, View and Group API of Manager so systems written against one can
+// be run on the other.
+
+namespace ECS {
+
+// Type erased operations used to move components between archetypes
+struct ArchetypeComponentInfo {
+	uint64_t typeID;
+	size_t size;
+	size_t alignment;
+	// Move constructs dst from src and destroys src
+	void (*relocate)(void* dst, void* src);
+	void (*destroy)(void*);
+	void (*swap)(void*, void*);
+
+	template <typename Component>
+	static const ArchetypeComponentInfo* get() {
+		static const ArchetypeComponentInfo info = make<Component>();
+		return &info;
+	}
+	private:
+		template <typename Component>
+		static ArchetypeComponentInfo make() {
+			// Empty components take no space in a chunk and are never constructed
+			if constexpr (std::is_empty_v<Component>) {
+				return {TypeIDGenerator::get_type_id<Component>(), 0, 1,
+						[](void*, void*) {}, [](void*) {}, [](void*, void*) {}};
+			}
+			else {
+				return {
+					TypeIDGenerator::get_type_id<Component>(),
+					sizeof(Component),
+					alignof(Component),
+					[](void* dst, void* src) {
+						auto* pSrc = static_cast<Component*>(src);
+						new (dst) Component(std::move(*pSrc));
+						pSrc->~Component();
+					},
+					[](void* ptr) {
+						static_cast<Component*>(ptr)->~Component();
+					},
+					[](void* a, void* b) {
+						using std::swap;
+						swap(*static_cast<Component*>(a), *static_cast<Component*>(b));
+					}
+				};
+			}
+		}
+};
+
+// Empty components have no storage, references to them all point at the same object
+template <typename Component>
+Component& get_empty_component() {
+	static Component value{};
+	return value;
+}
+
+class Archetype {
+	public:
+		static constexpr size_t CHUNK_SIZE = 16 * 1024;
+		static constexpr size_t CHUNK_ALIGNMENT = 64;
+		static constexpr size_t INVALID_COLUMN = ~static_cast<size_t>(0);
+
+		// components must be sorted by type ID
+		explicit Archetype(std::vector<const ArchetypeComponentInfo*> components);
+		~Archetype();
+
+		NULL_COPY_AND_ASSIGN(Archetype);
+
+		// Appends a row without constructing its components, returns the row index
+		size_t push_back(Entity);
+		// Destroys the components of row and moves the last row into its place. Returns the entity
+		// that was moved into row, or INVALID_ENTITY if row was the last row.
+		Entity erase(size_t row);
+		// Relocates the components of row that dst also has into dstRow and destroys the rest, then
+		// fills the hole like erase()
+		Entity move_row_to(size_t row, Archetype& dst, size_t dstRow);
+		void swap_rows(size_t i, size_t j);
+
+		size_t find_column(uint64_t typeID) const;
+		bool has_type(uint64_t typeID) const;
+
+		void* get_component(size_t column, size_t row);
+
+		template <typename Component>
+		Component* get_column(size_t column, size_t chunk) {
+			return reinterpret_cast<Component*>(m_chunks[chunk].get() + m_columnOffsets[column]);
+		}
+
+		Entity* get_entities(size_t chunk);
+		Entity get_entity(size_t row) const;
+
+		const std::vector<const ArchetypeComponentInfo*>& get_components() const;
+		const std::vector<uint64_t>& get_type_ids() const;
+
+		size_t size() const;
+		bool empty() const;
+		size_t get_chunk_capacity() const;
+		// Number of chunks holding at least one row
+		size_t get_num_chunks() const;
+		size_t get_chunk_size(size_t chunk) const;
+
+		// Cached transitions to the archetype with typeID added or removed
+		Archetype*& add_edge(uint64_t typeID);
+		Archetype*& remove_edge(uint64_t typeID);
+	private:
+		struct ChunkDeleter {
+			void operator()(std::byte* ptr) const {
+				::operator delete[](ptr, std::align_val_t{CHUNK_ALIGNMENT});
+			}
+		};
+
+		std::vector<std::unique_ptr<std::byte[], ChunkDeleter>> m_chunks;
+		std::vector<const ArchetypeComponentInfo*> m_components;
+		std::vector<uint64_t> m_typeIDs;
+		// Byte offset of each component array within a chunk, the entity array is at offset 0
+		std::vector<size_t> m_columnOffsets;
+		size_t m_chunkCapacity;
+		size_t m_chunkBytes;
+		size_t m_size = 0;
+		std::unordered_map<uint64_t, Archetype*> m_addEdges;
+		std::unordered_map<uint64_t, Archetype*> m_removeEdges;
+
+		Entity fill_hole(size_t row);
+		size_t compute_layout(size_t capacity, std::vector<size_t>& offsets) const;
+};
+
+class BaseArchetypeView {
+	public:
+		virtual ~BaseArchetypeView() = default;
+};
+
+template <typename... Components>
+class ArchetypeView;
+
+// Group is an alias of View for archetype storage since every archetype already stores the
+// components of its entities contiguously
+template <typename... Components>
+using ArchetypeGroup = ArchetypeView<Components...>;
+
+class ArchetypeManager {
+	public:
+		explicit ArchetypeManager();
+		~ArchetypeManager();
+
+		NULL_COPY_AND_ASSIGN(ArchetypeManager);
+
+		Entity create_entity();
+		void destroy_entity(Entity);
+
+		template <typename Component, typename... Args>
+		Component& add_component(Entity entity, Args&&... args) {
+			assert(!has_component<Component>(entity));
+
+			auto* info = ArchetypeComponentInfo::get<Component>();
+			auto& dst = get_add_target(*m_locations[get_index(entity)].archetype, info);
+			const size_t row = move_entity(entity, dst);
+
+			if constexpr (std::is_empty_v<Component>) {
+				return get_empty_component<Component>();
+			}
+			else {
+				void* ptr = dst.get_component(dst.find_column(info->typeID), row);
+
+				if constexpr (std::is_aggregate_v<Component>) {
+					return *new (ptr) Component{std::forward<Args>(args)...};
+				}
+				else {
+					return *new (ptr) Component(std::forward<Args>(args)...);
+				}
+			}
+		}
+
+		template <typename Component, typename... Args>
+		Component& get_or_add_component(Entity entity, Args&&... args) {
+			if (auto* pComponent = try_get_component<Component>(entity)) {
+				return *pComponent;
+			}
+
+			return add_component<Component>(entity, std::forward<Args>(args)...);
+		}
+
+		template <typename Component>
+		void remove_component(Entity entity) {
+			assert(has_component<Component>(entity));
+
+			auto* info = ArchetypeComponentInfo::get<Component>();
+			move_entity(entity, get_remove_target(*m_locations[get_index(entity)].archetype, info));
+		}
+
+		template <typename Component>
+		bool has_component(Entity entity) const {
+			return is_valid_entity(entity) && m_locations[get_index(entity)].archetype->has_type(
+					TypeIDGenerator::get_type_id<Component>());
+		}
+
+		template <typename... Components>
+		bool has_all_components(Entity entity) const {
+			return (has_component<Components>(entity) && ...);
+		}
+
+		template <typename Component>
+		Component& get_component(Entity entity) {
+			assert(entity != ECS::INVALID_ENTITY);
+
+			auto* pComponent = try_get_component<Component>(entity);
+			assert(pComponent);
+
+			return *pComponent;
+		}
+
+		template <typename Component>
+		Component* try_get_component(Entity entity) {
+			if (!is_valid_entity(entity)) {
+				return nullptr;
+			}
+
+			auto& location = m_locations[get_index(entity)];
+			const size_t column = location.archetype->find_column(
+					TypeIDGenerator::get_type_id<Component>());
+
+			if (column == Archetype::INVALID_COLUMN) {
+				return nullptr;
+			}
+
+			if constexpr (std::is_empty_v<Component>) {
+				return &get_empty_component<Component>();
+			}
+			else {
+				return static_cast<Component*>(location.archetype->get_component(column,
+						location.row));
+			}
+		}
+
+		bool is_valid_entity(Entity entity) const {
+			return entity != ECS::INVALID_ENTITY && m_entities.size() > get_index(entity)
+					&& m_entities[get_index(entity)] == entity;
+		}
+
+		// Removes Component from every entity that has it
+		template <typename Component>
+		void clear_pool() {
+			const auto typeID = TypeIDGenerator::get_type_id<Component>();
+
+			// Removing components may create archetypes, so iterate by index
+			for (size_t i = 0; i < m_archetypes.size(); ++i) {
+				auto& archetype = *m_archetypes[i];
+
+				if (archetype.has_type(typeID)) {
+					while (!archetype.empty()) {
+						remove_component<Component>(archetype.get_entity(archetype.size() - 1));
+					}
+				}
+			}
+		}
+
+		template <typename... Components>
+		ArchetypeGroup<Components...>& get_group() {
+			auto& pView = m_groups[{TypeIDGenerator::get_type_id<Components>()...}];
+
+			if (!pView) {
+				pView = std::make_unique<ArchetypeGroup<Components...>>(*this);
+			}
+
+			return static_cast<ArchetypeGroup<Components...>&>(*pView);
+		}
+
+		template <typename... Components>
+		ArchetypeView<Components...> get_view() {
+			return ArchetypeView<Components...>(*this);
+		}
+
+		template <typename... Components, typename Functor>
+		void run_system(Functor&& func) {
+			get_view<Components...>().for_each(std::forward<Functor>(func));
+		}
+
+		template <typename Functor>
+		void for_each_entity(Functor&& func) {
+			for (size_t i = 0; i < m_entities.size(); ++i) {
+				if (get_index(m_entities[i]) == i) {
+					func(m_entities[i]);
+				}
+			}
+		}
+
+		template <typename Component>
+		size_t get_pool_size() const {
+			const auto typeID = TypeIDGenerator::get_type_id<Component>();
+			size_t count = 0;
+
+			for (auto& pArchetype : m_archetypes) {
+				if (pArchetype->has_type(typeID)) {
+					count += pArchetype->size();
+				}
+			}
+
+			return count;
+		}
+
+		size_t get_num_archetypes() const;
+	private:
+		struct EntityLocation {
+			Archetype* archetype;
+			size_t row;
+		};
+
+		// Archetypes are never destroyed, so views only need to check the ones added since their
+		// last update
+		std::vector<std::unique_ptr<Archetype>> m_archetypes;
+		std::map<std::vector<uint64_t>, Archetype*> m_archetypeLookup;
+		std::map<std::vector<uint64_t>, std::unique_ptr<BaseArchetypeView>> m_groups;
+		std::vector<Entity> m_entities;
+		std::vector<EntityLocation> m_locations;
+		Entity m_freeList = INVALID_ENTITY;
+
+		Archetype& get_or_create_archetype(std::vector<const ArchetypeComponentInfo*> components);
+		Archetype& get_add_target(Archetype& src, const ArchetypeComponentInfo* info);
+		Archetype& get_remove_target(Archetype& src, const ArchetypeComponentInfo* info);
+
+		// Moves entity into dst, returns its new row
+		size_t move_entity(Entity entity, Archetype& dst);
+		void update_locations(Archetype&);
+
+		template <typename... Components>
+		friend class ArchetypeView;
+};
+
+template <typename... Components>
+class ArchetypeView final : public BaseArchetypeView {
+	public:
+		explicit ArchetypeView(ArchetypeManager& manager)
+				: m_manager(&manager) {}
+
+		// func must not add or remove components or create or destroy entities
+		template <typename Functor>
+		void for_each(Functor&& func) {
+			update_matches();
+
+			for (auto& match : m_matches) {
+				for (size_t chunk = 0, l = match.archetype->get_num_chunks(); chunk < l; ++chunk) {
+					for_each_in_chunk<false>(match, chunk, func, INDICES);
+				}
+			}
+		}
+
+		template <typename Functor>
+		void for_each_cond(Functor&& func) {
+			update_matches();
+
+			for (auto& match : m_matches) {
+				for (size_t chunk = 0, l = match.archetype->get_num_chunks(); chunk < l; ++chunk) {
+					if (!for_each_in_chunk<true>(match, chunk, func, INDICES)) {
+						return;
+					}
+				}
+			}
+		}
+
+		// Runs chunks of each matching archetype on g_jobSystem, each job covers at least one
+		// chunk and about chunkSize entities
+		template <typename Functor>
+		void par_for_each(Functor&& func, size_t chunkSize = DEFAULT_PARALLEL_CHUNK_SIZE) {
+			if (!g_jobSystem) {
+				for_each(std::forward<Functor>(func));
+				return;
+			}
+
+			update_matches();
+
+			for (auto& match : m_matches) {
+				const size_t chunksPerJob = std::max<size_t>(1,
+						chunkSize / match.archetype->get_chunk_capacity());
+
+				g_jobSystem->parallel_for(match.archetype->get_num_chunks(), chunksPerJob,
+						[&](size_t begin, size_t end) {
+					for (size_t chunk = begin; chunk < end; ++chunk) {
+						for_each_in_chunk<false>(match, chunk, func, INDICES);
+					}
+				});
+			}
+		}
+
+		// Stably sorts the entities of each matching archetype on CompareComponent. Entities are
+		// only ordered relative to others in the same archetype.
+		template <typename CompareComponent>
+		void sort_on_component() {
+			update_matches();
+
+			const auto typeID = TypeIDGenerator::get_type_id<CompareComponent>();
+
+			for (auto& match : m_matches) {
+				auto& archetype = *match.archetype;
+				const size_t column = archetype.find_column(typeID);
+
+				if (!SortUtils::compute_sort_permutation<CompareComponent>([&](size_t row)
+						-> const CompareComponent& {
+							return *static_cast<CompareComponent*>(archetype.get_component(column,
+									row));
+						}, archetype.size(), m_sortPermutation, m_sortScratch)) {
+					continue;
+				}
+
+				for (size_t i = 0; i < archetype.size(); ++i) {
+					size_t curr = i;
+
+					while (m_sortPermutation[curr] != i) {
+						const size_t next = m_sortPermutation[curr];
+						archetype.swap_rows(curr, next);
+						m_sortPermutation[curr] = static_cast<uint32_t>(curr);
+						curr = next;
+					}
+
+					m_sortPermutation[curr] = static_cast<uint32_t>(curr);
+				}
+
+				m_manager->update_locations(archetype);
+			}
+		}
+	private:
+		static constexpr auto INDICES = std::index_sequence_for<Components...>{};
+
+		struct Match {
+			Archetype* archetype;
+			std::array<size_t, sizeof...(Components)> columns;
+		};
+
+		ArchetypeManager* m_manager;
+		std::vector<Match> m_matches;
+		size_t m_numArchetypesChecked = 0;
+		std::vector<uint32_t> m_sortPermutation;
+		SortUtils::SortScratch m_sortScratch;
+
+		void update_matches() {
+			auto& archetypes = m_manager->m_archetypes;
+
+			for (; m_numArchetypesChecked < archetypes.size(); ++m_numArchetypesChecked) {
+				auto* pArchetype = archetypes[m_numArchetypesChecked].get();
+
+				if ((pArchetype->has_type(TypeIDGenerator::get_type_id<Components>()) && ...)) {
+					m_matches.push_back({pArchetype, {pArchetype->find_column(
+							TypeIDGenerator::get_type_id<Components>())...}});
+				}
+			}
+		}
+
+		template <typename Component>
+		static Component& get_element(Component* column, size_t index) {
+			if constexpr (std::is_empty_v<Component>) {
+				return get_empty_component<Component>();
+			}
+			else {
+				return column[index];
+			}
+		}
+
+		// Returns false if func returned IterationDecision::BREAK
+		template <bool CheckDecision, typename Functor, size_t... Indices>
+		static bool for_each_in_chunk(const Match& match, size_t chunk, Functor& func,
+				std::index_sequence<Indices...>) {
+			auto& archetype = *match.archetype;
+			const size_t count = archetype.get_chunk_size(chunk);
+			auto* entities = archetype.get_entities(chunk);
+			std::tuple<Components*...> columns{
+					archetype.template get_column<Components>(match.columns[Indices], chunk)...};
+
+			for (size_t i = 0; i < count; ++i) {
+				if constexpr (CheckDecision) {
+					if (auto res = func(entities[i], get_element(std::get<Indices>(columns), i)...);
+							res == IterationDecision::BREAK) {
+						return false;
+					}
+				}
+				else {
+					func(entities[i], get_element(std::get<Indices>(columns), i)...);
+				}
+			}
+
+			return true;
+		}
+};
+
+}
@@ -0,0 +1,76 @@
+#include "command_buffer.hpp"
+
+using namespace ECS;
+
+Entity CommandBuffer::create_entity() {
+	return make_entity(m_numPlaceholders++, get_generation(INVALID_ENTITY));
+}
+
+void CommandBuffer::destroy_entity(Entity entity) {
+	m_destroyedEntities.push_back(entity);
+}
+
+void CommandBuffer::apply(Manager& ecs) {
+	m_createdEntities.resize(m_numPlaceholders);
+
+	for (auto& entity : m_createdEntities) {
+		entity = ecs.create_entity();
+	}
+
+	for (auto& entity : m_destroyedEntities) {
+		entity = resolve(entity);
+	}
+
+	std::sort(m_destroyedEntities.begin(), m_destroyedEntities.end());
+	m_destroyedEntities.erase(std::unique(m_destroyedEntities.begin(), m_destroyedEntities.end()),
+			m_destroyedEntities.end());
+
+	for (auto& pQueue : m_queues) {
+		pQueue->apply(ecs, *this);
+	}
+
+	for (auto entity : m_destroyedEntities) {
+		if (ecs.is_valid_entity(entity)) {
+			ecs.destroy_entity(entity);
+		}
+	}
+
+	clear();
+}
+
+void CommandBuffer::clear() {
+	for (auto& pQueue : m_queues) {
+		pQueue->clear();
+	}
+
+	m_destroyedEntities.clear();
+	m_createdEntities.clear();
+	m_numPlaceholders = 0;
+}
+
+bool CommandBuffer::empty() const {
+	if (m_numPlaceholders != 0 || !m_destroyedEntities.empty()) {
+		return false;
+	}
+
+	for (auto& pQueue : m_queues) {
+		if (!pQueue->empty()) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+Entity CommandBuffer::resolve(Entity entity) const {
+	if (is_placeholder_entity(entity)) {
+		return m_createdEntities[get_index(entity)];
+	}
+
+	return entity;
+}
+
+bool CommandBuffer::is_alive(const Manager& ecs, Entity entity) const {
+	return ecs.is_valid_entity(entity) && !std::binary_search(m_destroyedEntities.begin(),
+			m_destroyedEntities.end(), entity);
+}
@@ -0,0 +1,198 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <ecs/ecs.hpp>
+
+namespace ECS {
+
+// Records structural changes so they can be applied to a Manager in one batch at a sync point,
+// which makes it safe to record them while iterating pools. A buffer is not thread safe, use one
+// buffer per thread when recording from jobs.
+//
+// apply() creates entities first, then removes and adds components pool by pool in entity order,
+// and destroys entities last. Commands on entities destroyed in the same buffer are dropped, adding
+// a component an entity already has overwrites it and removing a missing component does nothing.
+class CommandBuffer {
+	public:
+		CommandBuffer() = default;
+
+		CommandBuffer(CommandBuffer&&) = default;
+		CommandBuffer& operator=(CommandBuffer&&) = default;
+
+		CommandBuffer(const CommandBuffer&) = delete;
+		void operator=(const CommandBuffer&) = delete;
+
+		// Returns a placeholder which may be passed to this buffer's commands, it is replaced by
+		// a real entity when the buffer is applied
+		Entity create_entity();
+		void destroy_entity(Entity);
+
+		template <typename Component, typename... Args>
+		void add_component(Entity entity, Args&&... args) {
+			auto& queue = get_or_create_queue<Component>();
+			queue.m_addedEntities.push_back(entity);
+
+			if constexpr (!std::is_empty_v<Component>) {
+				if constexpr (std::is_aggregate_v<Component>) {
+					queue.m_addedComponents.emplace_back(Component{std::forward<Args>(args)...});
+				}
+				else {
+					queue.m_addedComponents.emplace_back(std::forward<Args>(args)...);
+				}
+			}
+		}
+
+		template <typename Component>
+		void remove_component(Entity entity) {
+			get_or_create_queue<Component>().m_removedEntities.push_back(entity);
+		}
+
+		void apply(Manager&);
+		void clear();
+
+		bool empty() const;
+	private:
+		class BaseQueue {
+			public:
+				virtual ~BaseQueue() = default;
+
+				virtual void apply(Manager&, CommandBuffer&) = 0;
+				virtual void clear() = 0;
+				virtual bool empty() const = 0;
+		};
+
+		template <typename Component>
+		class Queue final : public BaseQueue {
+			public:
+				void apply(Manager& ecs, CommandBuffer& buffer) override {
+					if (!m_removedEntities.empty()) {
+						apply_removes(ecs, buffer);
+					}
+
+					if (!m_addedEntities.empty()) {
+						apply_adds(ecs, buffer);
+					}
+				}
+
+				void clear() override {
+					m_removedEntities.clear();
+					m_addedEntities.clear();
+					m_addedComponents.clear();
+				}
+
+				bool empty() const override {
+					return m_removedEntities.empty() && m_addedEntities.empty();
+				}
+			private:
+				std::vector<Entity> m_removedEntities;
+				std::vector<Entity> m_addedEntities;
+				std::vector<Component> m_addedComponents;
+				std::vector<uint32_t> m_order;
+
+				void apply_removes(Manager& ecs, CommandBuffer& buffer) {
+					auto& pool = ecs.get_or_create_pool<Component>();
+					size_t numRemoved = 0;
+
+					for (auto entity : m_removedEntities) {
+						entity = buffer.resolve(entity);
+
+						if (buffer.is_alive(ecs, entity) && pool.contains(entity)) {
+							m_removedEntities[numRemoved++] = entity;
+						}
+					}
+
+					m_removedEntities.resize(numRemoved);
+					sort_and_unique(m_removedEntities);
+
+					ecs.remove_components<Component>(m_removedEntities.data(),
+							m_removedEntities.size());
+				}
+
+				void apply_adds(Manager& ecs, CommandBuffer& buffer) {
+					auto& pool = ecs.get_or_create_pool<Component>();
+
+					m_order.resize(m_addedEntities.size());
+
+					for (uint32_t i = 0; i < static_cast<uint32_t>(m_order.size()); ++i) {
+						m_addedEntities[i] = buffer.resolve(m_addedEntities[i]);
+						m_order[i] = i;
+					}
+
+					// Sort by entity index, the last add for an entity wins
+					std::stable_sort(m_order.begin(), m_order.end(), [&](auto a, auto b) {
+						return get_index(m_addedEntities[a]) < get_index(m_addedEntities[b]);
+					});
+
+					std::vector<Entity> entities;
+					std::vector<Component> components;
+					entities.reserve(m_order.size());
+
+					for (size_t i = 0; i < m_order.size(); ++i) {
+						const auto entity = m_addedEntities[m_order[i]];
+
+						if (i + 1 < m_order.size() && m_addedEntities[m_order[i + 1]] == entity) {
+							continue;
+						}
+
+						if (!buffer.is_alive(ecs, entity)) {
+							continue;
+						}
+
+						if (pool.contains(entity)) {
+							if constexpr (!std::is_empty_v<Component>) {
+								pool.get(entity) = std::move(m_addedComponents[m_order[i]]);
+							}
+
+							continue;
+						}
+
+						entities.push_back(entity);
+
+						if constexpr (!std::is_empty_v<Component>) {
+							components.push_back(std::move(m_addedComponents[m_order[i]]));
+						}
+					}
+
+					ecs.add_components<Component>(entities.data(), components.data(),
+							entities.size());
+				}
+
+				static void sort_and_unique(std::vector<Entity>& entities) {
+					std::sort(entities.begin(), entities.end(), [](auto a, auto b) {
+						return get_index(a) < get_index(b);
+					});
+					entities.erase(std::unique(entities.begin(), entities.end()), entities.end());
+				}
+
+				friend class CommandBuffer;
+		};
+
+		std::vector<std::unique_ptr<BaseQueue>> m_queues;
+		std::unordered_map<uint64_t, BaseQueue*> m_queueLookup;
+		std::vector<Entity> m_destroyedEntities;
+		// Real entities for the placeholders handed out by create_entity(), filled by apply()
+		std::vector<Entity> m_createdEntities;
+		uint32_t m_numPlaceholders = 0;
+
+		template <typename Component>
+		Queue<Component>& get_or_create_queue() {
+			auto& pQueue = m_queueLookup[TypeIDGenerator::get_type_id<Component>()];
+
+			if (!pQueue) {
+				pQueue = m_queues.emplace_back(std::make_unique<Queue<Component>>()).get();
+			}
+
+			return static_cast<Queue<Component>&>(*pQueue);
+		}
+
+		Entity resolve(Entity) const;
+		bool is_alive(const Manager&, Entity) const;
+};
+
+}
@@ -6,7 +6,9 @@
 #include <core/events.hpp>
 
 #include <ecs/ecs_fwd.hpp>
+#include <ecs/paged_storage.hpp>
 #include <ecs/sparse_set.hpp>
+#include <ecs/tag_bitset.hpp>
 #include <ecs/type_id_generator.hpp>
 
 namespace ECS {
@@ -15,6 +17,8 @@ template <typename Component, typename = void>
 class ComponentPool : public SparseSet {
 	public:
 		using ComponentEvent = Event::Dispatcher<Entity, Component&>;
+		using Storage = std::conditional_t<ComponentStorageTraits<Component>::PAGED,
+				PagedStorage<Component>, std::vector<Component>>;
 
 		Component& get(Entity key) {
 			return m_components[get_sparse_index(key)];
@@ -38,6 +42,20 @@ class ComponentPool : public SparseSet {
 			m_addedEvent.fire(entity, m_components.back());
 		}
 
+		// Adds count entities, moving their values out of components, and notifies the added
+		// listeners once for the whole batch
+		void emplace_range(const Entity* entities, Component* components, size_t count) {
+			const size_t first = m_components.size();
+			m_components.reserve(first + count);
+
+			for (size_t i = 0; i < count; ++i) {
+				insert(entities[i]);
+				m_components.emplace_back(std::move(components[i]));
+			}
+
+			fire_range(m_addedEvent, first, count);
+		}
+
 		void find_and_swap_to(Entity entity, size_t destIndex) {
 			const auto srcIndex = get_sparse_index(entity);
 			swap(srcIndex, destIndex);
@@ -48,20 +66,14 @@ class ComponentPool : public SparseSet {
 
 			m_removedEvent.fire(entity, m_components[index]);
 
-			std::swap(m_components[index], m_components.back());
+			swap_components(index, m_components.size() - 1);
 			m_components.pop_back();
 
 			SparseSet::remove(entity);
 		}
 
 		void clear() override {
-			if (!m_removedEvent.empty()) {
-				auto& dense = get_dense();
-
-				for (size_t i = 0, l = dense.size(); i < l; ++i) {
-					m_removedEvent.fire(dense[i], m_components[i]);
-				}
-			}
+			fire_range(m_removedEvent, 0, size());
 
 			SparseSet::clear();
 			m_components.clear();
@@ -71,6 +83,7 @@ class ComponentPool : public SparseSet {
 			return TypeIDGenerator::get_type_id<Component>();
 		}
 
+		// Only available for contiguous, non paged pools
 		Component* get_components() {
 			return m_components.data();
 		}
@@ -97,14 +110,42 @@ class ComponentPool : public SparseSet {
 
 		void swap(size_t i, size_t j) override {
 			SparseSet::swap(i, j);
-			std::swap(m_components[i], m_components[j]);
+			swap_components(i, j);
 		}
 	private:
-		std::vector<Component> m_components;
+		Storage m_components;
 		ComponentEvent m_addedEvent;
 		ComponentEvent m_removedEvent;
+
+		// Paged components stay in place, only their dense positions are exchanged
+		void swap_components(size_t i, size_t j) {
+			if constexpr (ComponentStorageTraits<Component>::PAGED) {
+				m_components.swap_elements(i, j);
+			}
+			else {
+				std::swap(m_components[i], m_components[j]);
+			}
+		}
+
+		// Fires event for the dense positions [first, first + count)
+		void fire_range(ComponentEvent& event, size_t first, size_t count) {
+			if constexpr (ComponentStorageTraits<Component>::PAGED) {
+				if (!event.empty()) {
+					auto& dense = get_dense();
+
+					for (size_t i = first; i < first + count; ++i) {
+						event.fire(dense[i], m_components[i]);
+					}
+				}
+			}
+			else {
+				event.fire_range(count, get_dense().data() + first, m_components.data() + first);
+			}
+		}
 };
 
+// Tag pools mirror membership in a bitset, so membership tests are a single bit test and clearing
+// the pool, as is done every frame for transient tags, is O(1) when nothing listens for removals
 template <typename Component>
 class ComponentPool<Component, std::enable_if_t<std::is_empty_v<Component>>> : public SparseSet {
 	public:
@@ -120,25 +161,58 @@ class ComponentPool<Component, std::enable_if_t<std::is_empty_v<Component>>> : p
 			return m_value;
 		}
 
+		bool contains(Entity entity) const {
+			return m_bits.test(entity);
+		}
+
 		template <typename... Args>
 		void emplace(Entity entity, Args&&...) {
 			insert(entity);
-			m_addedEvent.fire(entity);
+			m_bits.set(entity);
+
+			if (!m_addedEvent.empty()) {
+				m_addedEvent.fire(entity);
+			}
+		}
+
+		// components is ignored and may be null
+		void emplace_range(const Entity* entities, Component*, size_t count) {
+			for (size_t i = 0; i < count; ++i) {
+				insert(entities[i]);
+				m_bits.set(entities[i]);
+			}
+
+			m_addedEvent.fire_range(count, entities);
 		}
 
+		// Entities whose tag was dropped by clear() may still be passed here by the Manager, so
+		// removing an absent entity is a no-op
 		void remove(Entity entity) override {
+			if (!m_bits.test(entity)) {
+				return;
+			}
+
 			m_removedEvent.fire(entity);
+			m_bits.reset(entity);
 			SparseSet::remove(entity);
 		}
 
+		// Removals are not logged, for_each_removed does not see entities dropped by a clear
 		void clear() override {
-			if (!m_removedEvent.empty()) {
-				for (auto entity : get_dense()) {
-					m_removedEvent.fire(entity);
-				}
-			}
+			m_removedEvent.fire_range(size(), get_dense().data());
 
-			SparseSet::clear();
+			SparseSet::clear_by_epoch();
+			m_bits.clear();
+		}
+
+		// Calls func(entity) for every tagged entity in increasing index order
+		template <typename Functor>
+		void for_each_tagged(Functor&& func) {
+			auto& dense = get_dense();
+
+			m_bits.for_each_index([&](EntityIndex_T index) {
+				func(dense[get_sparse_index(make_entity(index, 0))]);
+			});
 		}
 
 		void find_and_swap_to(Entity entity, size_t destIndex) {
@@ -162,6 +236,7 @@ class ComponentPool<Component, std::enable_if_t<std::is_empty_v<Component>>> : p
 			return m_removedEvent;
 		}
 	private:
+		TagBitset m_bits;
 		ComponentEvent m_addedEvent;
 		ComponentEvent m_removedEvent;
 		Component m_value;
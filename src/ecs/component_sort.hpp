@@ -0,0 +1,242 @@
+#pragma once
+
+#include <cstdint>
+
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+
+namespace ECS {
+
+struct RadixKey128 {
+	uint64_t high;
+	uint64_t low;
+};
+
+// Specialize for a component to let Group::sort_on_component radix sort it. get() must return an
+// uint64_t or a RadixKey128 which orders the same way as the component's operator<.
+template <typename T, typename = void>
+struct RadixSortKey {
+	static constexpr bool ENABLED = false;
+};
+
+template <typename T>
+struct RadixSortKey<T, std::enable_if_t<std::is_integral_v<T>>> {
+	static constexpr bool ENABLED = true;
+
+	static uint64_t get(T value) {
+		if constexpr (std::is_signed_v<T>) {
+			return static_cast<uint64_t>(static_cast<int64_t>(value)) ^ (1ull << 63);
+		}
+		else {
+			return static_cast<uint64_t>(value);
+		}
+	}
+};
+
+}
+
+namespace ECS::SortUtils {
+
+// Maximum fraction (1 / N) of out of order elements for which the almost sorted path is taken
+static constexpr size_t ALMOST_SORTED_DIVISOR = 8;
+
+template <typename Key>
+struct KeyIndex {
+	Key key;
+	uint32_t index;
+};
+
+template <typename Entry>
+struct SortBuffers {
+	std::vector<Entry> entries;
+	std::vector<Entry> scratch;
+	std::vector<Entry> outliers;
+};
+
+// Buffers of compute_sort_permutation, kept by their owner next to its permutation so sorting
+// every frame does not allocate once they have grown to the largest count
+struct SortScratch {
+	SortBuffers<KeyIndex<uint64_t>> keys64;
+	SortBuffers<KeyIndex<RadixKey128>> keys128;
+	SortBuffers<uint32_t> indices;
+
+	template <typename Entry>
+	SortBuffers<Entry>& get() {
+		if constexpr (std::is_same_v<Entry, KeyIndex<uint64_t>>) {
+			return keys64;
+		}
+		else if constexpr (std::is_same_v<Entry, KeyIndex<RadixKey128>>) {
+			return keys128;
+		}
+		else {
+			static_assert(std::is_same_v<Entry, uint32_t>);
+			return indices;
+		}
+	}
+};
+
+inline uint32_t get_digit(uint64_t key, uint32_t pass) {
+	return static_cast<uint32_t>(key >> (8 * pass)) & 0xFF;
+}
+
+inline uint32_t get_digit(const RadixKey128& key, uint32_t pass) {
+	return pass < 8 ? get_digit(key.low, pass) : get_digit(key.high, pass - 8);
+}
+
+inline bool key_less(uint64_t a, uint64_t b) {
+	return a < b;
+}
+
+inline bool key_less(const RadixKey128& a, const RadixKey128& b) {
+	return a.high < b.high || (a.high == b.high && a.low < b.low);
+}
+
+// Stable LSD radix sort on 8 bit digits, passes where every key shares the same digit are skipped
+template <typename Key>
+void radix_sort(std::vector<KeyIndex<Key>>& entries, std::vector<KeyIndex<Key>>& scratch) {
+	constexpr uint32_t NUM_PASSES = sizeof(Key);
+
+	scratch.resize(entries.size());
+
+	for (uint32_t pass = 0; pass < NUM_PASSES; ++pass) {
+		size_t offsets[256] = {};
+
+		for (auto& entry : entries) {
+			++offsets[get_digit(entry.key, pass)];
+		}
+
+		if (offsets[get_digit(entries[0].key, pass)] == entries.size()) {
+			continue;
+		}
+
+		size_t sum = 0;
+
+		for (auto& offset : offsets) {
+			auto count = offset;
+			offset = sum;
+			sum += count;
+		}
+
+		for (auto& entry : entries) {
+			scratch[offsets[get_digit(entry.key, pass)]++] = entry;
+		}
+
+		entries.swap(scratch);
+	}
+}
+
+// Sorts entries that are already close to sorted in O(n + k log k) for k out of order entries.
+// Out of order entries are pulled out together with the in order entry they violate, the
+// remaining entries form a sorted run that the sorted outliers are merged back into. Returns false
+// without modifying entries if too many entries are out of order.
+template <typename Entry, typename Less>
+bool try_sort_almost_sorted(std::vector<Entry>& entries, std::vector<Entry>& scratch,
+		std::vector<Entry>& outliers, Less&& less) {
+	const size_t maxOutliers = entries.size() / ALMOST_SORTED_DIVISOR;
+
+	outliers.clear();
+	scratch.clear();
+
+	for (auto& entry : entries) {
+		if (!scratch.empty() && less(entry, scratch.back())) {
+			outliers.push_back(scratch.back());
+			outliers.push_back(entry);
+			scratch.pop_back();
+
+			if (outliers.size() > maxOutliers) {
+				return false;
+			}
+		}
+		else {
+			scratch.push_back(entry);
+		}
+	}
+
+	if (outliers.empty()) {
+		return true;
+	}
+
+	std::sort(outliers.begin(), outliers.end(), less);
+
+	entries.resize(scratch.size() + outliers.size());
+	std::merge(scratch.begin(), scratch.end(), outliers.begin(), outliers.end(), entries.begin(),
+			less);
+
+	return true;
+}
+
+// Computes the permutation which stably sorts count components, getComponent(i) returns the
+// component at dense index i. permutation[i] is the current index of the component that belongs
+// at index i. Returns false if the components are already sorted.
+template <typename Component, typename GetComponent>
+bool compute_sort_permutation(GetComponent&& getComponent, size_t count,
+		std::vector<uint32_t>& permutation, SortScratch& sortScratch) {
+	permutation.clear();
+
+	if (count < 2) {
+		return false;
+	}
+
+	if constexpr (RadixSortKey<Component>::ENABLED) {
+		using Key = decltype(RadixSortKey<Component>::get(getComponent(0)));
+		using Entry = KeyIndex<Key>;
+
+		auto& [entries, scratch, outliers] = sortScratch.get<Entry>();
+		entries.resize(count);
+		bool sorted = true;
+
+		for (size_t i = 0; i < count; ++i) {
+			entries[i] = {RadixSortKey<Component>::get(getComponent(i)), static_cast<uint32_t>(i)};
+			sorted = sorted && (i == 0 || !key_less(entries[i].key, entries[i - 1].key));
+		}
+
+		if (sorted) {
+			return false;
+		}
+
+		if (!try_sort_almost_sorted(entries, scratch, outliers, [](const Entry& a, const Entry& b) {
+			return key_less(a.key, b.key) || (!key_less(b.key, a.key) && a.index < b.index);
+		})) {
+			radix_sort(entries, scratch);
+		}
+
+		permutation.resize(count);
+
+		for (size_t i = 0; i < count; ++i) {
+			permutation[i] = entries[i].index;
+		}
+	}
+	else {
+		bool sorted = true;
+
+		for (size_t i = 1; i < count && sorted; ++i) {
+			sorted = !(getComponent(i) < getComponent(i - 1));
+		}
+
+		if (sorted) {
+			return false;
+		}
+
+		auto& buffers = sortScratch.get<uint32_t>();
+		auto less = [&](uint32_t a, uint32_t b) {
+			auto& compA = getComponent(a);
+			auto& compB = getComponent(b);
+			return compA < compB || (!(compB < compA) && a < b);
+		};
+
+		permutation.resize(count);
+
+		for (size_t i = 0; i < count; ++i) {
+			permutation[i] = static_cast<uint32_t>(i);
+		}
+
+		if (!try_sort_almost_sorted(permutation, buffers.scratch, buffers.outliers, less)) {
+			std::sort(permutation.begin(), permutation.end(), less);
+		}
+	}
+
+	return true;
+}
+
+}
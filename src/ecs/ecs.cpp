@@ -1,66 +1,80 @@
 #include "ecs.hpp"
 
-using namespace ECS;
-
-static constexpr EntityGeneration_T get_generation(Entity entity) {
-	return static_cast<EntityGeneration_T>((entity >> GENERATION_SHIFT) & GENERATION_MASK);
-}
+#include <algorithm>
+#include <bit>
 
-static constexpr Entity make_entity(EntityIndex_T index, EntityGeneration_T generation) {
-	return static_cast<Entity>((index & INDEX_MASK) | (generation << GENERATION_SHIFT));
-}
+using namespace ECS;
 
-static constexpr void increment_generation(Entity& entity) {
-	EntityGeneration_T generation = get_generation(entity) + 1;
-	generation += generation == get_generation(INVALID_ENTITY);
+// SparseSet
 
-	entity = make_entity(get_index(entity), generation);
+static constexpr size_t get_page(Entity entity) {
+	return get_index(entity) / SparseSet::PAGE_SIZE;
 }
 
-static constexpr void swap_indices(Entity& lhs, Entity& rhs) {
-	EntityIndex_T temp = get_index(lhs);
-	lhs = make_entity(get_index(rhs), get_generation(lhs));
-	rhs = make_entity(temp, get_generation(rhs));
+static constexpr size_t get_page_offset(Entity entity) {
+	return get_index(entity) & (SparseSet::PAGE_SIZE - 1);
 }
 
-// SparseSet
-
 void SparseSet::insert(Entity entity) {
-	if (m_sparse.size() <= get_index(entity)) {
-		m_sparse.resize(get_index(entity) + 1, INVALID_ENTITY);
-	}
-
-	m_sparse[get_index(entity)] = static_cast<Entity>(m_dense.size());
+	get_or_create_sparse_entry(entity) = static_cast<EntityIndex_T>(m_dense.size());
 	m_dense.push_back(entity);
+	m_addedTicks.push_back(m_currentTick);
+	m_changedTicks.push_back(m_currentTick);
 }
 
 void SparseSet::remove(Entity entity) {
 	if (contains(entity)) {
 		const Entity last = m_dense.back();
+		auto& entry = get_sparse_entry(entity);
 
-		m_dense[m_sparse[get_index(entity)]] = last;
-		m_sparse[get_index(last)] = m_sparse[get_index(entity)];
-		m_sparse[get_index(entity)] = INVALID_ENTITY;
+		m_dense[entry] = last;
+		m_addedTicks[entry] = m_addedTicks.back();
+		m_changedTicks[entry] = m_changedTicks.back();
+		get_sparse_entry(last) = entry;
+		release_sparse_entry(entity);
 
 		m_dense.pop_back();
+		m_addedTicks.pop_back();
+		m_changedTicks.pop_back();
+
+		log_removal(entity);
 	}
 }
 
 void SparseSet::clear() {
-	// FIXME: this might be faster if I had pages
-	for (auto entity : m_dense) {
-		m_sparse[get_index(entity)] = INVALID_ENTITY;
+	if (m_logRemovals) {
+		prune_removals();
+
+		for (auto entity : m_dense) {
+			m_removals.push_back({entity, m_currentTick});
+		}
 	}
 
+	// Pools cleared every frame would otherwise reallocate their pages every frame
+	clear_by_epoch();
+}
+
+void SparseSet::clear_by_epoch() {
+	// Stale pages could only be mistaken for live ones once the epoch wraps around
+	if (++m_epoch == 0) {
+		m_sparse.clear();
+	}
+
+	m_numEmptyPages = 0;
+
 	m_dense.clear();
+	m_addedTicks.clear();
+	m_changedTicks.clear();
 }
 
 bool SparseSet::contains(Entity entity) const {
-	return m_sparse.size() > get_index(entity) && m_sparse[get_index(entity)] != INVALID_ENTITY;
+	const auto page = get_page(entity);
+	return m_sparse.size() > page && m_sparse[page].entries && m_sparse[page].epoch == m_epoch
+			&& m_sparse[page].entries[get_page_offset(entity)] != INVALID_DENSE_INDEX;
 }
 
 bool SparseSet::contains_before_index(Entity entity, size_t indexEnd) const {
-	return contains(entity) && m_sparse[get_index(entity)] < indexEnd;
+	return contains(entity) && get_sparse_entry(entity) < indexEnd;
 }
 
 bool SparseSet::empty() const {
@@ -76,15 +90,17 @@ void SparseSet::swap_to_match(const SparseSet& other, size_t numToSwap) {
 
 	for (size_t i = 0; i < numToSwap; ++i) {
 		if (m_dense[i] != other.m_dense[i]) {
-			const auto swapIndex = get_index(m_sparse[get_index(other.m_dense[i])]);
+			const auto swapIndex = get_sparse_entry(other.m_dense[i]);
 			swap(i, swapIndex);
 		}
 	}
 }
 
 void SparseSet::swap(size_t i, size_t j) {
-	std::swap(m_sparse[get_index(m_dense[i])], m_sparse[get_index(m_dense[j])]);
+	std::swap(get_sparse_entry(m_dense[i]), get_sparse_entry(m_dense[j]));
 	std::swap(m_dense[i], m_dense[j]);
+	std::swap(m_addedTicks[i], m_addedTicks[j]);
+	std::swap(m_changedTicks[i], m_changedTicks[j]);
 }
 
 std::vector<Entity>& SparseSet::get_dense() {
@@ -96,7 +112,193 @@ const std::vector<Entity>& SparseSet::get_dense() const {
 }
 
 size_t SparseSet::get_sparse_index(Entity entity) const {
-	return m_sparse[get_index(entity)];
+	return get_sparse_entry(entity);
+}
+
+size_t SparseSet::get_num_pages() const {
+	size_t result = 0;
+
+	for (auto& page : m_sparse) {
+		result += page.entries && page.epoch == m_epoch && page.count > 0;
+	}
+
+	return result;
+}
+
+size_t SparseSet::get_memory_usage() const {
+	size_t numAllocatedPages = 0;
+
+	// Pages from older epochs stay allocated
+	for (auto& page : m_sparse) {
+		numAllocatedPages += page.entries != nullptr;
+	}
+
+	return numAllocatedPages * PAGE_SIZE * sizeof(EntityIndex_T) + m_sparse.capacity() * sizeof(Page)
+			+ m_dense.capacity() * sizeof(Entity)
+			+ (m_addedTicks.capacity() + m_changedTicks.capacity()) * sizeof(uint32_t);
+}
+
+EntityIndex_T& SparseSet::get_or_create_sparse_entry(Entity entity) {
+	const auto pageIndex = get_page(entity);
+
+	if (m_sparse.size() <= pageIndex) {
+		m_sparse.resize(pageIndex + 1);
+	}
+
+	auto& page = m_sparse[pageIndex];
+
+	if (!page.entries || page.epoch != m_epoch) {
+		if (!page.entries) {
+			page.entries = std::make_unique<EntityIndex_T[]>(PAGE_SIZE);
+		}
+
+		page.count = 0;
+		page.epoch = m_epoch;
+		std::fill_n(page.entries.get(), PAGE_SIZE, INVALID_DENSE_INDEX);
+	}
+	else if (page.count == 0) {
+		// A kept empty page, its entries were invalidated as they were released
+		--m_numEmptyPages;
+	}
+
+	++page.count;
+
+	return page.entries[get_page_offset(entity)];
+}
+
+EntityIndex_T& SparseSet::get_sparse_entry(Entity entity) {
+	return m_sparse[get_page(entity)].entries[get_page_offset(entity)];
+}
+
+const EntityIndex_T& SparseSet::get_sparse_entry(Entity entity) const {
+	return m_sparse[get_page(entity)].entries[get_page_offset(entity)];
+}
+
+void SparseSet::release_sparse_entry(Entity entity) {
+	auto& page = m_sparse[get_page(entity)];
+	page.entries[get_page_offset(entity)] = INVALID_DENSE_INDEX;
+
+	if (--page.count == 0) {
+		// Entities toggling a component would otherwise reallocate the page every time
+		if (m_numEmptyPages < MAX_RETAINED_EMPTY_PAGES) {
+			++m_numEmptyPages;
+		}
+		else {
+			page.entries.reset();
+		}
+	}
+}
+
+void SparseSet::mark_changed(Entity entity) {
+	m_changedTicks[get_sparse_entry(entity)] = m_currentTick;
+}
+
+bool SparseSet::added_since(Entity entity, uint32_t sinceTick) const {
+	return contains(entity) && is_tick_newer(m_addedTicks[get_sparse_entry(entity)], sinceTick);
+}
+
+bool SparseSet::changed_since(Entity entity, uint32_t sinceTick) const {
+	return contains(entity) && is_tick_newer(m_changedTicks[get_sparse_entry(entity)], sinceTick);
+}
+
+void SparseSet::set_current_tick(uint32_t tick) {
+	m_currentTick = tick;
+	prune_removals();
+}
+
+uint32_t SparseSet::get_current_tick() const {
+	return m_currentTick;
+}
+
+const std::vector<SparseSet::Removal>& SparseSet::get_removals() const {
+	return m_removals;
+}
+
+void SparseSet::enable_removal_log() {
+	m_logRemovals = true;
+}
+
+void SparseSet::log_removal(Entity entity) {
+	if (m_logRemovals) {
+		prune_removals();
+		m_removals.push_back({entity, m_currentTick});
+	}
+}
+
+void SparseSet::prune_removals() {
+	if (!m_removals.empty() && m_currentTick - m_removals.front().tick > REMOVAL_HISTORY_TICKS) {
+		auto it = std::find_if(m_removals.begin(), m_removals.end(), [&](const auto& removal) {
+			return m_currentTick - removal.tick <= REMOVAL_HISTORY_TICKS;
+		});
+		m_removals.erase(m_removals.begin(), it);
+	}
+}
+
+uint32_t SparseSet::get_pool_index() const {
+	return m_poolIndex;
+}
+
+void SparseSet::set_pool_index(uint32_t poolIndex) {
+	m_poolIndex = poolIndex;
+}
+
+// TagPoolTable
+
+static constexpr size_t INITIAL_TAG_TABLE_SIZE = 32;
+
+// Tag values from hashed strings are already well distributed, mixing only helps small values
+static constexpr uint64_t mix_tag_value(uint64_t tagValue) {
+	return tagValue * 0x9E3779B97F4A7C15ull;
+}
+
+SparseSet* TagPoolTable::find(uint64_t tagValue) const {
+	if (m_slots.empty()) {
+		return nullptr;
+	}
+
+	return m_slots[find_slot(tagValue)].pool.get();
+}
+
+std::unique_ptr<SparseSet>& TagPoolTable::get_or_insert(uint64_t tagValue) {
+	// Keep the load factor at or below 1/2
+	if ((m_size + 1) * 2 > m_slots.size()) {
+		grow();
+	}
+
+	auto& slot = m_slots[find_slot(tagValue)];
+
+	if (!slot.pool) {
+		slot.tagValue = tagValue;
+		++m_size;
+	}
+
+	return slot.pool;
+}
+
+// Returns the slot holding tagValue, or the empty slot it would be inserted into
+size_t TagPoolTable::find_slot(uint64_t tagValue) const {
+	const size_t mask = m_slots.size() - 1;
+
+	for (size_t i = mix_tag_value(tagValue) >> 32;; ++i) {
+		auto& slot = m_slots[i & mask];
+
+		if (!slot.pool || slot.tagValue == tagValue) {
+			return i & mask;
+		}
+	}
+}
+
+void TagPoolTable::grow() {
+	auto oldSlots = std::move(m_slots);
+	m_slots = std::vector<Slot>(oldSlots.empty() ? INITIAL_TAG_TABLE_SIZE : oldSlots.size() * 2);
+
+	for (auto& oldSlot : oldSlots) {
+		if (oldSlot.pool) {
+			auto& slot = m_slots[find_slot(oldSlot.tagValue)];
+			slot.tagValue = oldSlot.tagValue;
+			slot.pool = std::move(oldSlot.pool);
+		}
+	}
 }
 
 // Manager
@@ -110,7 +312,10 @@ Manager::~Manager() {
 
 Entity Manager::create_entity() {
 	if (m_freeList == INVALID_ENTITY) {
+		// The all ones index terminates the free list
+		assert(m_entities.size() < INDEX_MASK && "Out of entity indices, see USE_64_BIT_ENTITIES");
 		m_entities.push_back(m_entities.size());
+		m_signatures.resize(m_entities.size() * m_signatureWords);
 		return m_entities.back();
 	}
 	else {
@@ -122,18 +327,122 @@ Entity Manager::create_entity() {
 }
 
 void Manager::destroy_entity(Entity entity) {
-	for (auto& [_, pPool] : m_componentPools) {
-		if (pPool->contains(entity)) {
+	for (size_t word = 0; word < m_signatureWords; ++word) {
+		// Removal events may create entities and reallocate the signatures, so refetch them
+		for (auto bits = get_signature(entity)[word]; bits != 0; bits &= bits - 1) {
+			auto& pool = *m_poolList[word * 64 + std::countr_zero(bits)];
+
 			for (auto it = m_groups.rbegin(), end = m_groups.rend(); it != end; ++it) {
-				if ((*it)->contains_type(pPool->get_type_id())) {
+				if ((*it)->contains_type(pool.get_type_id())) {
 					(*it)->on_entity_removed(entity);
 				}
 			}
 
-			pPool->remove(entity);
+			pool.remove(entity);
 		}
+
+		get_signature(entity)[word] = 0;
 	}
 
+	release_entity(entity);
+}
+
+void Manager::destroy_entities(std::span<const Entity> entities) {
+	m_destroyBuckets.resize(m_poolList.size());
+
+	// Bucket the entities by pool so that each pool and its groups are processed in one pass
+	for (auto entity : entities) {
+		assert(is_valid_entity(entity));
+
+		auto* signature = get_signature(entity);
+
+		for (size_t word = 0; word < m_signatureWords; ++word) {
+			for (auto bits = signature[word]; bits != 0; bits &= bits - 1) {
+				m_destroyBuckets[word * 64 + std::countr_zero(bits)].push_back(entity);
+			}
+
+			signature[word] = 0;
+		}
+	}
+
+	for (size_t poolIndex = 0; poolIndex < m_destroyBuckets.size(); ++poolIndex) {
+		auto& bucket = m_destroyBuckets[poolIndex];
+
+		if (bucket.empty()) {
+			continue;
+		}
+
+		auto& pool = *m_poolList[poolIndex];
+
+		for (auto it = m_groups.rbegin(), end = m_groups.rend(); it != end; ++it) {
+			if ((*it)->contains_type(pool.get_type_id())) {
+				for (auto entity : bucket) {
+					(*it)->on_entity_removed(entity);
+				}
+			}
+		}
+
+		for (auto entity : bucket) {
+			pool.remove(entity);
+		}
+
+		bucket.clear();
+	}
+
+	for (auto entity : entities) {
+		release_entity(entity);
+	}
+}
+
+void Manager::update_deferred_groups(size_t maxEntities) {
+	for (auto& pGroup : m_groups) {
+		if (maxEntities == 0) {
+			return;
+		}
+
+		if (!pGroup->is_built()) {
+			maxEntities -= pGroup->build_step(maxEntities);
+		}
+	}
+}
+
+uint32_t Manager::advance_tick() {
+	++m_currentTick;
+
+	for (auto* pPool : m_poolList) {
+		pPool->set_current_tick(m_currentTick);
+	}
+
+	return m_currentTick;
+}
+
+uint32_t Manager::get_current_tick() const {
+	return m_currentTick;
+}
+
+void Manager::register_pool(SparseSet& pool) {
+	pool.set_pool_index(static_cast<uint32_t>(m_poolList.size()));
+	pool.set_current_tick(m_currentTick);
+	m_poolList.push_back(&pool);
+
+	if (m_poolList.size() <= m_signatureWords * 64) {
+		return;
+	}
+
+	// Widen every signature by one word
+	const size_t newWords = m_signatureWords + 1;
+	std::vector<uint64_t> signatures(m_entities.size() * newWords);
+
+	for (size_t i = 0; i < m_entities.size(); ++i) {
+		std::copy_n(m_signatures.data() + i * m_signatureWords, m_signatureWords,
+				signatures.data() + i * newWords);
+	}
+
+	m_signatures = std::move(signatures);
+	m_signatureWords = newWords;
+}
+
+void Manager::release_entity(Entity entity) {
 	increment_generation(m_entities[get_index(entity)]);
 	swap_indices(m_freeList, m_entities[get_index(entity)]);
 }
@@ -157,11 +466,11 @@ void Manager::insert_new_group_sorted(BaseGroup* pGroup) {
 #include <core/logging.hpp>
 
 void Manager::dump() {
-	for (auto& [typeID, pSet] : m_componentPools) {
-		LOG_TEMP("TYPE %u", typeID);
+	for (auto* pPool : m_poolList) {
+		LOG_TEMP("TYPE %u", pPool->get_type_id());
 
-		for (auto e : pSet->get_dense()) {
-			LOG_TEMP("%d", e);
+		for (auto e : pPool->get_dense()) {
+			LOG_TEMP("%llu", static_cast<unsigned long long>(e));
 		}
 	}
 }
@@ -4,6 +4,7 @@
 
 #include <algorithm>
 #include <memory>
+#include <span>
 #include <tuple>
 #include <type_traits>
 #include <unordered_map>
@@ -16,11 +17,21 @@
 
 #include <ecs/ecs_fwd.hpp>
 #include <ecs/component_pool.hpp>
+#include <ecs/component_sort.hpp>
+#include <ecs/query.hpp>
+#include <ecs/tag_pool_table.hpp>
 #include <ecs/view.hpp>
 
 namespace ECS {
 	class Manager;
 
+	enum class GroupBuildMode {
+		// Owned region is built when the group is created
+		IMMEDIATE,
+		// Owned region is built over several calls to Manager::update_deferred_groups
+		DEFERRED
+	};
+
 	class BaseGroup {
 		public:
 			virtual ~BaseGroup() = 0;
@@ -28,6 +39,11 @@ namespace ECS {
 			virtual void on_entity_removed(Entity) = 0;
 			virtual void on_pool_cleared() = 0;
 
+			// Processes up to maxEntities pending entities of a deferred build, returns the number
+			// of entities processed
+			virtual size_t build_step(size_t maxEntities) = 0;
+			virtual bool is_built() const = 0;
+
 			virtual size_t get_num_types() const = 0;
 			virtual bool contains_type(uint64_t typeID) const = 0;
 
@@ -50,7 +66,75 @@ namespace ECS {
 			~Group() override = default;
 			static_assert(sizeof...(Components) > 1, "Must be >1 components");
 
-			explicit Group(Manager& reg, ComponentPool<Components>&... pools);
+			explicit Group(GroupBuildMode, ComponentPool<Components>&... pools);
+
+			// Iterates the owned region, skipping entities rejected by its tick filters
+			class Filtered {
+				public:
+					explicit Filtered(Group& group)
+							: m_group(&group) {}
+
+					template <typename Component>
+					Filtered changed(uint32_t sinceTick) const {
+						Filtered result = *this;
+						result.m_filters.add(*std::get<ComponentPool<Component>*>(m_group->m_pools),
+								sinceTick, false);
+						return result;
+					}
+
+					template <typename Component>
+					Filtered added(uint32_t sinceTick) const {
+						Filtered result = *this;
+						result.m_filters.add(*std::get<ComponentPool<Component>*>(m_group->m_pools),
+								sinceTick, true);
+						return result;
+					}
+
+					template <typename Functor>
+					void for_each(Functor&& func) {
+						auto& entities = std::get<0>(m_group->m_pools)->get_dense();
+
+						for (size_t i = 0; i < m_group->m_numComponents; ++i) {
+							if (m_filters.accepts_index(i)) {
+								func(entities[i], std::get<ComponentPool<Components>*>(
+										m_group->m_pools)->get_by_index(i)...);
+							}
+						}
+					}
+
+					template <typename Functor>
+					void for_each_cond(Functor&& func) {
+						auto& entities = std::get<0>(m_group->m_pools)->get_dense();
+
+						for (size_t i = 0; i < m_group->m_numComponents; ++i) {
+							if (!m_filters.accepts_index(i)) {
+								continue;
+							}
+
+							if (auto res = func(entities[i], std::get<ComponentPool<Components>*>(
+									m_group->m_pools)->get_by_index(i)...);
+									res == IterationDecision::BREAK) {
+								return;
+							}
+						}
+					}
+				private:
+					Group* m_group;
+					TickFilters m_filters;
+			};
+
+			// Only visit entities whose Component was changed (or added) after sinceTick. Owned
+			// pools share the group's dense order, so filters are checked by index.
+			template <typename Component>
+			Filtered changed(uint32_t sinceTick) {
+				return Filtered(*this).template changed<Component>(sinceTick);
+			}
+
+			// Only visit entities whose Component was added after sinceTick
+			template <typename Component>
+			Filtered added(uint32_t sinceTick) {
+				return Filtered(*this).template added<Component>(sinceTick);
+			}
 
 			template <typename Functor>
 			void for_each(Functor&& func) {
@@ -75,17 +159,49 @@ namespace ECS {
 				}
 			}
 
+			// Like for_each, but splits the owned region into chunks that run on g_jobSystem. func
+			// must be safe to call concurrently for different entities.
+			template <typename Functor>
+			void par_for_each(Functor&& func, size_t chunkSize = DEFAULT_PARALLEL_CHUNK_SIZE) {
+				if (!g_jobSystem) {
+					for_each(std::forward<Functor>(func));
+					return;
+				}
+
+				auto* entities = std::get<0>(m_pools)->get_dense().data();
+
+				g_jobSystem->parallel_for(m_numComponents, chunkSize, [&](size_t begin,
+						size_t end) {
+					for (size_t i = begin; i < end; ++i) {
+						func(entities[i],
+								std::get<ComponentPool<Components>*>(m_pools)->get_by_index(i)...);
+					}
+				});
+			}
+
+			// Stably sorts the owned region on CompareComponent. The sorting permutation is computed
+			// up front and then applied to every owned pool in one pass over its cycles.
 			template <typename CompareComponent>
 			void sort_on_component() {
+				auto* pool = std::get<ComponentPool<CompareComponent>*>(m_pools);
+
+				if (!SortUtils::compute_sort_permutation<CompareComponent>([&](size_t index)
+						-> const CompareComponent& { return pool->get_by_index(index); },
+						m_numComponents, m_sortPermutation, m_sortScratch)) {
+					return;
+				}
+
 				for (size_t i = 0; i < m_numComponents; ++i) {
-					size_t j = i;
+					size_t curr = i;
 
-					while (j > 0 && std::get<ComponentPool<CompareComponent>*>(m_pools)
-							->get_by_index(j) < std::get<ComponentPool<CompareComponent>*>(m_pools)
-							->get_by_index(j - 1)) {
-						swap(j, j - 1);
-						--j;
+					while (m_sortPermutation[curr] != i) {
+						const size_t next = m_sortPermutation[curr];
+						swap(curr, next);
+						m_sortPermutation[curr] = static_cast<uint32_t>(curr);
+						curr = next;
 					}
+
+					m_sortPermutation[curr] = static_cast<uint32_t>(curr);
 				}
 			}
 
@@ -113,6 +229,28 @@ namespace ECS {
 				m_numComponents = 0;
 			}
 
+			size_t build_step(size_t maxEntities) override {
+				const size_t numRemaining = m_pendingEntities.size() - m_pendingIndex;
+				const size_t numToProcess = maxEntities < numRemaining ? maxEntities : numRemaining;
+
+				for (size_t i = 0; i < numToProcess; ++i) {
+					on_entity_added(m_pendingEntities[m_pendingIndex + i]);
+				}
+
+				m_pendingIndex += numToProcess;
+
+				if (m_pendingIndex == m_pendingEntities.size()) {
+					std::vector<Entity>().swap(m_pendingEntities);
+					m_pendingIndex = 0;
+				}
+
+				return numToProcess;
+			}
+
+			bool is_built() const override {
+				return m_pendingEntities.empty();
+			}
+
 			size_t get_num_types() const override {
 				return sizeof...(Components);
 			}
@@ -124,6 +262,12 @@ namespace ECS {
 			std::tuple<ComponentPool<Components>*...> m_pools;
 			size_t m_numComponents;
 			std::unordered_set<uint64_t> m_typeIDs;
+			// Snapshot of the smallest pool taken by a deferred build, entities added afterwards
+			// are picked up through on_entity_added
+			std::vector<Entity> m_pendingEntities;
+			size_t m_pendingIndex;
+			std::vector<uint32_t> m_sortPermutation;
+			SortUtils::SortScratch m_sortScratch;
 
 			template <typename Component>
 			void match_smallest_pool(ComponentPool<Component>& pool, SparseSet& smallestPool) {
@@ -142,7 +286,8 @@ namespace ECS {
 
 			// whether any pool (contains(entity) && indexof(entity) < m_numComponents)
 			bool should_remove_entity(Entity entity) {
-				return (std::get<ComponentPool<Components>*>(m_pools)->contains(entity) && ...);
+				return (std::get<ComponentPool<Components>*>(m_pools)->contains(entity) && ...)
+						&& std::get<0>(m_pools)->get_sparse_index(entity) < m_numComponents;
 			}
 	};
 
@@ -158,7 +303,10 @@ namespace ECS {
 			void operator=(const Manager&) = delete;
 
 			Entity create_entity();
+			// Only visits the pools the entity has components in
 			void destroy_entity(Entity);
+			// Destroys a batch of valid, distinct entities, removing them from each pool in one pass
+			void destroy_entities(std::span<const Entity>);
 
 			template <typename Component, typename... Args>
 			decltype(auto) add_component(Entity entity, Args&&... args) {
@@ -166,6 +314,7 @@ namespace ECS {
 
 				auto& pool = get_or_create_pool<Component>();
 				pool.emplace(entity, std::forward<Args>(args)...);
+				set_signature_bit(entity, pool.get_pool_index());
 
 				for (auto& pGroup : m_groups) {
 					if (pGroup->contains_type<Component>()) {
@@ -173,7 +322,8 @@ namespace ECS {
 					}
 				}
 
-				return pool.back();
+				// Groups may have moved the new component away from the back of the pool
+				return pool.get(entity);
 			}
 
 			template <typename Component, typename... Args>
@@ -198,43 +348,132 @@ namespace ECS {
 				}
 
 				auto& pool = get_pool<Component>();
+				clear_signature_bit(entity, pool.get_pool_index());
 				pool.remove(entity);
 			}
 
+			// Adds components to count entities, taking the values from components (which may be
+			// null for empty components). Each group is notified in a single pass over the batch.
 			template <typename Component>
-			bool has_component(Entity entity) const {
-				auto it = m_componentPools.find(TypeIDGenerator::get_type_id<Component>());
+			void add_components(const Entity* entities, Component* components, size_t count) {
+				auto& pool = get_or_create_pool<Component>();
+
+				for (size_t i = 0; i < count; ++i) {
+					assert(!pool.contains(entities[i]));
+					set_signature_bit(entities[i], pool.get_pool_index());
+				}
+
+				pool.emplace_range(entities, components, count);
+
+				for (auto& pGroup : m_groups) {
+					if (pGroup->contains_type<Component>()) {
+						for (size_t i = 0; i < count; ++i) {
+							pGroup->on_entity_added(entities[i]);
+						}
+					}
+				}
+			}
+
+			// Removes the component from count entities, each group is notified in a single pass
+			// over the batch before the pool is modified
+			template <typename Component>
+			void remove_components(const Entity* entities, size_t count) {
+				for (auto it = m_groups.rbegin(), end = m_groups.rend(); it != end; ++it) {
+					if ((*it)->contains_type<Component>()) {
+						for (size_t i = 0; i < count; ++i) {
+							(*it)->on_entity_removed(entities[i]);
+						}
+					}
+				}
+
+				auto& pool = get_pool<Component>();
 
-				if (it == m_componentPools.end() || !it->second) {
-					return false;
+				for (size_t i = 0; i < count; ++i) {
+					assert(pool.contains(entities[i]));
+					clear_signature_bit(entities[i], pool.get_pool_index());
+					pool.remove(entities[i]);
 				}
+			}
+
+			template <typename Component>
+			bool has_component(Entity entity) const {
+				auto* pPool = static_cast<ComponentPool<Component>*>(find_pool<Component>());
+				return pPool && pPool->contains(entity);
+			}
 
-				return it->second->contains(entity);
+			// Runtime lookup of Tag<tagValue> components
+			bool has_tag(Entity entity, uint64_t tagValue) const {
+				auto* pPool = m_tagPools.find(tagValue);
+				return pPool && pPool->contains(entity);
 			}
 
+			// Lookups do not stamp the changed tick, writes are recorded with get_component_mut or
+			// mark_changed
 			template <typename Component>
 			Component& get_component(Entity entity) {
 				assert(entity != ECS::INVALID_ENTITY);
 				return get_pool<Component>().get(entity);
 			}
 
+			// Stamps the component's changed tick for the caller to write it
 			template <typename Component>
-			Component* try_get_component(Entity entity) {
-				auto it = m_componentPools.find(TypeIDGenerator::get_type_id<Component>());
+			Component& get_component_mut(Entity entity) {
+				assert(entity != ECS::INVALID_ENTITY);
 
-				if (it == m_componentPools.end() || !it->second) {
-					return nullptr;
-				}
+				auto& pool = get_pool<Component>();
+				const auto index = pool.get_sparse_index(entity);
+				pool.mark_changed_by_index(index);
 
-				if (it->second->contains(entity)) {
-					auto* pool = static_cast<ComponentPool<Component>*>(it->second.get());
-					return &pool->get(entity);
+				return pool.get_by_index(index);
+			}
+
+			template <typename Component>
+			const Component& get_component(Entity entity) const {
+				assert(entity != ECS::INVALID_ENTITY);
+				return const_cast<Manager*>(this)->get_pool<Component>().get(entity);
+			}
+
+			template <typename Component>
+			Component* try_get_component(Entity entity) {
+				auto* pPool = static_cast<ComponentPool<Component>*>(find_pool<Component>());
+
+				if (pPool && pPool->contains(entity)) {
+					return &pPool->get(entity);
 				}
 				else {
 					return nullptr;
 				}
 			}
 
+			template <typename Component>
+			void mark_changed(Entity entity) {
+				get_pool<Component>().mark_changed(entity);
+			}
+
+			// Calls func(entity) for every entity whose Component was removed after sinceTick,
+			// including destroyed entities. The pool only logs removals from the first call on,
+			// and only the last SparseSet::REMOVAL_HISTORY_TICKS ticks of them are kept.
+			template <typename Component, typename Functor>
+			void for_each_removed(uint32_t sinceTick, Functor&& func) {
+				auto& pool = get_or_create_pool<Component>();
+				pool.enable_removal_log();
+
+				auto& removals = pool.get_removals();
+
+				auto it = std::find_if(removals.begin(), removals.end(), [&](const auto& removal) {
+					return is_tick_newer(removal.tick, sinceTick);
+				});
+
+				for (auto end = removals.end(); it != end; ++it) {
+					func(it->entity);
+				}
+			}
+
+			// Starts a new change tick and returns it. A system that stores the tick it last ran
+			// at can pass it to the changed/added filters to only visit entities touched since.
+			uint32_t advance_tick();
+			uint32_t get_current_tick() const;
+
 			bool is_valid_entity(Entity entity) const {
 				return entity != ECS::INVALID_ENTITY && m_entities.size() > get_index(entity)
 						&& m_entities[get_index(entity)] == entity;
@@ -242,13 +481,13 @@ namespace ECS {
 
 			template <typename Component>
 			void clear_pool() {
-				auto it = m_componentPools.find(TypeIDGenerator::get_type_id<Component>());
+				auto* pPool = find_pool<Component>();
 
-				if (it == m_componentPools.end() || !it->second) {
+				if (!pPool) {
 					return;
 				}
 
-				auto& pool = *static_cast<ComponentPool<Component>*>(it->second.get());
+				auto& pool = *static_cast<ComponentPool<Component>*>(pPool);
 
 				for (auto& pGroup : m_groups) {
 					if (pGroup->contains_type<Component>()) {
@@ -256,22 +495,76 @@ namespace ECS {
 					}
 				}
 
+				// Tag pools clear in O(1) and leave the signature bits set, destroying an entity
+				// with a stale bit only makes a no-op call to the pool's remove
+				if constexpr (!std::is_empty_v<Component>) {
+					for (auto entity : pool.get_dense()) {
+						clear_signature_bit(entity, pool.get_pool_index());
+					}
+				}
+
 				pool.clear();
 			}
 
 			template <typename... Components>
 			Group<Components...>& get_group() {
 				if (auto* pGroup = find_group<Components...>(); pGroup) {
+					if (!pGroup->is_built()) {
+						pGroup->build_step(~static_cast<size_t>(0));
+					}
+
 					return *pGroup;
 				}
 				else {
-					pGroup = new Group<Components...>(*this, get_or_create_pool<Components>()...);
+					pGroup = new Group<Components...>(GroupBuildMode::IMMEDIATE,
+							get_or_create_pool<Components>()...);
 					insert_new_group_sorted(pGroup);
 
 					return *pGroup;
 				}
 			}
 
+			// Creates the group without building its owned region, the build is spread out over
+			// calls to update_deferred_groups(). Until is_built() returns true, iterating the group
+			// only visits the entities processed so far.
+			template <typename... Components>
+			Group<Components...>& get_group_deferred() {
+				if (auto* pGroup = find_group<Components...>(); pGroup) {
+					return *pGroup;
+				}
+				else {
+					pGroup = new Group<Components...>(GroupBuildMode::DEFERRED,
+							get_or_create_pool<Components>()...);
+					insert_new_group_sorted(pGroup);
+
+					return *pGroup;
+				}
+			}
+
+			// Returns the persistent query matching IncludeList and not ExcludeList, e.g.
+			// get_query<Include<A, B>, Exclude<C>>(). The query is built from the smallest included
+			// pool on first use and maintained by the pools' events afterwards.
+			template <typename IncludeList, typename ExcludeList = Exclude<>>
+			Query<IncludeList, ExcludeList>& get_query() {
+				using QueryType = Query<IncludeList, ExcludeList>;
+				const uint64_t typeID = TypeIDGenerator::get_type_id<QueryType>();
+
+				for (auto& [id, pQuery] : m_queries) {
+					if (id == typeID) {
+						return static_cast<QueryType&>(*pQuery);
+					}
+				}
+
+				auto* pQuery = create_query(static_cast<IncludeList*>(nullptr),
+						static_cast<ExcludeList*>(nullptr));
+				m_queries.emplace_back(typeID, pQuery);
+
+				return *pQuery;
+			}
+
+			// Advances pending deferred group builds by up to maxEntities entities in total
+			void update_deferred_groups(size_t maxEntities);
+
 			template <typename Functor>
 			void for_each_entity(Functor&& func) {
 				for (size_t i = 0; i < m_entities.size(); ++i) {
@@ -291,18 +584,38 @@ namespace ECS {
 				return View(get_or_create_pool<Components>()...);
 			}
 
+			// Per-manager state that belongs to no particular entity, stored as the only Context
+			// component of an entity created on first use
+			template <typename Context>
+			Context& get_context() {
+				auto& pool = get_or_create_pool<Context>();
+
+				if (pool.empty()) {
+					return add_component<Context>(create_entity());
+				}
+
+				return pool.get_by_index(0);
+			}
+
 			template <typename Component>
 			ComponentPool<Component>& get_pool() {
-				return static_cast<ComponentPool<Component>&>(*m_componentPools[
-						TypeIDGenerator::get_type_id<Component>()]);
+				auto* pPool = find_pool<Component>();
+				assert(pPool);
+
+				return static_cast<ComponentPool<Component>&>(*pPool);
 			}
 
 			template <typename Component>
 			ComponentPool<Component>& get_or_create_pool() {
-				auto& pPool = m_componentPools[TypeIDGenerator::get_type_id<Component>()];
+				if (auto* pPool = find_pool<Component>(); pPool) {
+					return static_cast<ComponentPool<Component>&>(*pPool);
+				}
+
+				auto& pPool = get_pool_slot<Component>();
 
 				if (!pPool) {
 					pPool.reset(new ComponentPool<Component>{});
+					register_pool(*pPool);
 				}
 
 				return static_cast<ComponentPool<Component>&>(*pPool);
@@ -330,7 +643,7 @@ namespace ECS {
 
 			template <typename... Components>
 			bool has_all_components(Entity entity) const {
-				return (get_pool<Components>().contains(entity) && ...);
+				return (has_component<Components>(entity) && ...);
 			}
 
 			template <typename Component>
@@ -345,10 +658,66 @@ namespace ECS {
 
 			void dump();
 		private:
-			std::unordered_map<uint64_t, std::unique_ptr<SparseSet>> m_componentPools;
+			// Pools of non-tag components, indexed by TypeIDGenerator ID
+			std::vector<std::unique_ptr<SparseSet>> m_componentPools;
+			TagPoolTable m_tagPools;
 			std::vector<std::unique_ptr<BaseGroup>> m_groups;
+			// Keyed by the query's TypeIDGenerator ID. Declared after the pools so queries
+			// disconnect from them before the pools are destroyed.
+			std::vector<std::pair<uint64_t, std::unique_ptr<BaseQuery>>> m_queries;
 			std::vector<Entity> m_entities;
 			Entity m_freeList = INVALID_ENTITY;
+			// Pools in creation order. Each entity has a signature of m_signatureWords words in
+			// m_signatures, bit i is set when it has a component in m_poolList[i].
+			std::vector<SparseSet*> m_poolList;
+			std::vector<uint64_t> m_signatures;
+			size_t m_signatureWords = 0;
+			uint32_t m_currentTick = 1;
+			// Per pool scratch lists used by destroy_entities
+			std::vector<std::vector<Entity>> m_destroyBuckets;
+
+			uint64_t* get_signature(Entity entity) {
+				return m_signatures.data() + get_index(entity) * m_signatureWords;
+			}
+
+			void set_signature_bit(Entity entity, uint32_t poolIndex) {
+				get_signature(entity)[poolIndex / 64] |= uint64_t{1} << (poolIndex % 64);
+			}
+
+			void clear_signature_bit(Entity entity, uint32_t poolIndex) {
+				get_signature(entity)[poolIndex / 64] &= ~(uint64_t{1} << (poolIndex % 64));
+			}
+
+			template <typename Component>
+			SparseSet* find_pool() const {
+				if constexpr (TagTraits<Component>::IS_TAG) {
+					return m_tagPools.find(TagTraits<Component>::VALUE);
+				}
+				else {
+					const auto typeID = TypeIDGenerator::get_type_id<Component>();
+					return typeID < m_componentPools.size() ? m_componentPools[typeID].get()
+							: nullptr;
+				}
+			}
+
+			template <typename Component>
+			std::unique_ptr<SparseSet>& get_pool_slot() {
+				if constexpr (TagTraits<Component>::IS_TAG) {
+					return m_tagPools.get_or_insert(TagTraits<Component>::VALUE);
+				}
+				else {
+					const auto typeID = TypeIDGenerator::get_type_id<Component>();
+
+					if (m_componentPools.size() <= typeID) {
+						m_componentPools.resize(typeID + 1);
+					}
+
+					return m_componentPools[typeID];
+				}
+			}
+
+			void register_pool(SparseSet&);
+			void release_entity(Entity);
 
 			template <typename... Components>
 			Group<Components...>* find_group() {
@@ -362,20 +731,35 @@ namespace ECS {
 			}
 
 			void insert_new_group_sorted(BaseGroup*);
+
+			template <typename... Included, typename... Excluded>
+			Query<Include<Included...>, Exclude<Excluded...>>* create_query(Include<Included...>*,
+					Exclude<Excluded...>*) {
+				return new Query<Include<Included...>, Exclude<Excluded...>>(
+						std::make_tuple(&get_or_create_pool<Included>()...),
+						std::make_tuple(&get_or_create_pool<Excluded>()...));
+			}
 	};
 }
 
 template <typename... Components>
-inline ECS::Group<Components...>::Group(Manager& reg, ComponentPool<Components>&... pools)
+inline ECS::Group<Components...>::Group(GroupBuildMode buildMode,
+			ComponentPool<Components>&... pools)
 		: m_pools(&pools...)
 		, m_numComponents(0)
-		, m_typeIDs{TypeIDGenerator::get_type_id<Components>()...} {
+		, m_typeIDs{TypeIDGenerator::get_type_id<Components>()...}
+		, m_pendingIndex(0) {
 
 	auto* smallestPool = (std::min<SparseSet*>({&pools...},
 			[](const auto& a, const auto& b) { return a->size() < b->size(); }));
 
-	m_numComponents = smallestPool->swap_back_all([reg_ = &reg](Entity entity) {
-		return reg_->has_all_components<Components...>(entity);
+	if (buildMode == GroupBuildMode::DEFERRED) {
+		m_pendingEntities = smallestPool->get_dense();
+		return;
+	}
+
+	m_numComponents = smallestPool->partition([&](Entity entity) {
+		return (pools.contains(entity) && ...);
 	});
 
 	(match_smallest_pool(pools, *smallestPool), ...);
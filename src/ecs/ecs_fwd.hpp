@@ -1,25 +1,92 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 
 namespace ECS {
+	// Entities pack an index and a generation. By default this is a 20 bit index and a 12 bit
+	// generation in 32 bits, defining USE_64_BIT_ENTITIES gives a 32 bit index and a 32 bit
+	// generation for worlds with more than ~1M entities or heavy slot reuse.
+#ifdef USE_64_BIT_ENTITIES
+	using Entity = uint64_t;
+	using EntityIndex_T = uint32_t;
+	using EntityGeneration_T = uint32_t;
+
+	constexpr Entity INDEX_MASK = 0xFFFF'FFFF;
+	constexpr Entity GENERATION_MASK = 0xFFFF'FFFF;
+	constexpr size_t GENERATION_SHIFT = 32;
+#else
 	using Entity = uint32_t;
 	using EntityIndex_T = uint32_t;
 	using EntityGeneration_T = uint16_t;
 
-	constexpr Entity INVALID_ENTITY = static_cast<Entity>(~0);
-
 	constexpr Entity INDEX_MASK = 0xFFFFF;
 	constexpr Entity GENERATION_MASK = 0xFFF;
 	constexpr size_t GENERATION_SHIFT = 20;
+#endif
+
+	constexpr Entity INVALID_ENTITY = static_cast<Entity>(~0);
 
 	constexpr EntityIndex_T get_index(Entity entity) {
 		return static_cast<EntityIndex_T>(entity & INDEX_MASK);
 	}
 
+	constexpr EntityGeneration_T get_generation(Entity entity) {
+		return static_cast<EntityGeneration_T>((entity >> GENERATION_SHIFT) & GENERATION_MASK);
+	}
+
+	constexpr Entity make_entity(EntityIndex_T index, EntityGeneration_T generation) {
+		return (static_cast<Entity>(index) & INDEX_MASK)
+				| ((static_cast<Entity>(generation) & GENERATION_MASK) << GENERATION_SHIFT);
+	}
+
+	constexpr void increment_generation(Entity& entity) {
+		EntityGeneration_T generation = get_generation(entity) + 1;
+		generation += generation == get_generation(INVALID_ENTITY);
+
+		entity = make_entity(get_index(entity), generation);
+	}
+
+	// Used by the entity free lists, which are threaded through the index bits of dead entities
+	constexpr void swap_indices(Entity& lhs, Entity& rhs) {
+		EntityIndex_T temp = get_index(lhs);
+		lhs = make_entity(get_index(rhs), get_generation(lhs));
+		rhs = make_entity(temp, get_generation(rhs));
+	}
+
+	// The generation of INVALID_ENTITY is never handed out by the Manager, CommandBuffer uses it to
+	// mark entities that are only created once the buffer is applied
+	constexpr bool is_placeholder_entity(Entity entity) {
+		return entity != INVALID_ENTITY
+				&& get_generation(entity) == get_generation(INVALID_ENTITY);
+	}
+
+	// Change ticks wrap around, a tick is newer than sinceTick if it was stamped after it
+	constexpr bool is_tick_newer(uint32_t tick, uint32_t sinceTick) {
+		return static_cast<int32_t>(tick - sinceTick) > 0;
+	}
+
 	template <uint64_t Value>
 	struct Tag {};
 
+	// Specialize with PAGED = true to store a component type in a PagedStorage, whose components
+	// never move once added
+	template <typename T>
+	struct ComponentStorageTraits {
+		static constexpr bool PAGED = false;
+	};
+
+	template <typename T>
+	struct TagTraits {
+		static constexpr bool IS_TAG = false;
+	};
+
+	template <uint64_t Value>
+	struct TagTraits<Tag<Value>> {
+		static constexpr bool IS_TAG = true;
+		static constexpr uint64_t VALUE = Value;
+	};
+
 	class Manager;
 }
 
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstddef>
+
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace ECS {
+
+// Dense component storage whose elements never move. Elements are constructed in fixed-size pages
+// and addressed through a dense array of pointers, so growing never copies an element and
+// swapping two dense positions only swaps pointers. A pointer to an element stays valid until
+// that element is removed.
+template <typename T>
+class PagedStorage {
+	public:
+		static constexpr size_t PAGE_BYTES = 16 * 1024;
+		static constexpr size_t PAGE_CAPACITY = std::max<size_t>(1, PAGE_BYTES / sizeof(T));
+
+		PagedStorage() = default;
+
+		~PagedStorage() {
+			clear();
+		}
+
+		PagedStorage(PagedStorage&&) = delete;
+		void operator=(PagedStorage&&) = delete;
+
+		template <typename... Args>
+		T& emplace_back(Args&&... args) {
+			T* slot = acquire_slot();
+			new (slot) T(std::forward<Args>(args)...);
+			m_elements.push_back(slot);
+
+			return *slot;
+		}
+
+		// Destroys the last element in place and recycles its slot
+		void pop_back() {
+			T* slot = m_elements.back();
+			slot->~T();
+
+			m_elements.pop_back();
+			m_freeSlots.push_back(slot);
+		}
+
+		void swap_elements(size_t i, size_t j) {
+			std::swap(m_elements[i], m_elements[j]);
+		}
+
+		void clear() {
+			for (T* slot : m_elements) {
+				slot->~T();
+			}
+
+			m_elements.clear();
+			m_freeSlots.clear();
+			m_numBumpSlots = 0;
+		}
+
+		void reserve(size_t count) {
+			m_elements.reserve(count);
+
+			while (capacity() < count) {
+				m_pages.emplace_back(allocate_page());
+			}
+		}
+
+		T& operator[](size_t index) {
+			return *m_elements[index];
+		}
+
+		const T& operator[](size_t index) const {
+			return *m_elements[index];
+		}
+
+		T& back() {
+			return *m_elements.back();
+		}
+
+		size_t size() const {
+			return m_elements.size();
+		}
+
+		bool empty() const {
+			return m_elements.empty();
+		}
+
+		size_t capacity() const {
+			return m_pages.size() * PAGE_CAPACITY;
+		}
+	private:
+		struct PageDeleter {
+			void operator()(T* page) const {
+				::operator delete(page, std::align_val_t{alignof(T)});
+			}
+		};
+
+		using Page = std::unique_ptr<T, PageDeleter>;
+
+		std::vector<Page> m_pages;
+		// Dense order of the live elements
+		std::vector<T*> m_elements;
+		// Slots released by pop_back, reused before new slots are taken from the pages
+		std::vector<T*> m_freeSlots;
+		// Slots [0, m_numBumpSlots) across the pages have been handed out at least once
+		size_t m_numBumpSlots = 0;
+
+		static Page allocate_page() {
+			return Page(static_cast<T*>(::operator new(PAGE_CAPACITY * sizeof(T),
+					std::align_val_t{alignof(T)})));
+		}
+
+		T* acquire_slot() {
+			if (!m_freeSlots.empty()) {
+				T* slot = m_freeSlots.back();
+				m_freeSlots.pop_back();
+				return slot;
+			}
+
+			if (m_numBumpSlots == capacity()) {
+				m_pages.emplace_back(allocate_page());
+			}
+
+			const size_t slotIndex = m_numBumpSlots++;
+			return m_pages[slotIndex / PAGE_CAPACITY].get() + slotIndex % PAGE_CAPACITY;
+		}
+};
+
+}
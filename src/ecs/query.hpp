@@ -0,0 +1,203 @@
+#pragma once
+
+#include <cstdint>
+
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include <core/common.hpp>
+
+#include <ecs/component_pool.hpp>
+
+namespace ECS {
+
+template <typename... Components>
+struct Include {};
+
+template <typename... Components>
+struct Exclude {};
+
+class BaseQuery {
+	public:
+		virtual ~BaseQuery() = default;
+};
+
+template <typename IncludeList, typename ExcludeList = Exclude<>>
+class Query;
+
+// Persistent list of the entities that have every included component and none of the excluded
+// ones. The list is kept up to date from the added and removed events of the pools, so iterating
+// it never visits an entity that does not match. Entities are visited in the order they started
+// matching, removing one moves the last entity into its place.
+template <typename... Included, typename... Excluded>
+class Query<Include<Included...>, Exclude<Excluded...>> final : public BaseQuery {
+	public:
+		static_assert(sizeof...(Included) > 0, "Must include at least 1 component");
+
+		explicit Query(std::tuple<ComponentPool<Included>*...> included,
+				std::tuple<ComponentPool<Excluded>*...> excluded)
+				: m_included(included)
+				, m_excluded(excluded) {
+			(connect_included<Included>(), ...);
+			(connect_excluded<Excluded>(), ...);
+
+			SparseSet* smallestPool = std::get<0>(m_included);
+			((smallestPool = std::get<ComponentPool<Included>*>(m_included)->size()
+					< smallestPool->size() ? std::get<ComponentPool<Included>*>(m_included)
+					: smallestPool), ...);
+
+			for (auto entity : smallestPool->get_dense()) {
+				if (matches(entity)) {
+					insert(entity);
+				}
+			}
+		}
+
+		~Query() override {
+			(disconnect<Included>(std::get<ComponentPool<Included>*>(m_included)), ...);
+			(disconnect<Excluded>(std::get<ComponentPool<Excluded>*>(m_excluded)), ...);
+		}
+
+		Query(const Query&) = delete;
+		void operator=(const Query&) = delete;
+
+		// func(entity, included...) must not add or remove any of the query's components
+		template <typename Functor>
+		void for_each(Functor&& func) {
+			for (size_t i = 0; i < m_dense.size(); ++i) {
+				const Entity entity = m_dense[i];
+				func(entity, std::get<ComponentPool<Included>*>(m_included)->get(entity)...);
+			}
+		}
+
+		// Stops as soon as func(entity, included...) returns IterationDecision::BREAK
+		template <typename Functor>
+		void for_each_cond(Functor&& func) {
+			for (size_t i = 0; i < m_dense.size(); ++i) {
+				const Entity entity = m_dense[i];
+
+				if (auto res = func(entity,
+						std::get<ComponentPool<Included>*>(m_included)->get(entity)...);
+						res == IterationDecision::BREAK) {
+					return;
+				}
+			}
+		}
+
+		bool contains(Entity entity) const {
+			const auto index = get_index(entity);
+			return index < m_sparse.size() && m_sparse[index] < m_dense.size()
+					&& m_dense[m_sparse[index]] == entity;
+		}
+
+		std::span<const Entity> get_entities() const {
+			return m_dense;
+		}
+
+		size_t size() const {
+			return m_dense.size();
+		}
+
+		bool empty() const {
+			return m_dense.empty();
+		}
+	private:
+		template <typename Component>
+		struct Connections {
+			typename ComponentPool<Component>::ComponentEvent::Connection added;
+			typename ComponentPool<Component>::ComponentEvent::Connection removed;
+		};
+
+		static constexpr uint32_t INVALID_DENSE_INDEX = ~uint32_t{0};
+
+		std::tuple<ComponentPool<Included>*...> m_included;
+		std::tuple<ComponentPool<Excluded>*...> m_excluded;
+		std::tuple<Connections<Included>..., Connections<Excluded>...> m_connections;
+		std::vector<Entity> m_dense;
+		// Dense index of each matching entity by entity index
+		std::vector<uint32_t> m_sparse;
+
+		template <typename Component>
+		void connect_included() {
+			auto* pool = std::get<ComponentPool<Component>*>(m_included);
+			auto& connections = std::get<Connections<Component>>(m_connections);
+
+			// Added events fire once the component is in the pool
+			connections.added = pool->added_event().connect([this](Entity entity, auto&&...) {
+				if (!contains(entity) && matches(entity)) {
+					insert(entity);
+				}
+			});
+
+			connections.removed = pool->removed_event().connect([this](Entity entity, auto&&...) {
+				erase(entity);
+			});
+		}
+
+		template <typename Component>
+		void connect_excluded() {
+			auto* pool = std::get<ComponentPool<Component>*>(m_excluded);
+			auto& connections = std::get<Connections<Component>>(m_connections);
+
+			connections.added = pool->added_event().connect([this](Entity entity, auto&&...) {
+				erase(entity);
+			});
+
+			// Removed events fire while the component is still in the pool
+			connections.removed = pool->removed_event().connect([this](Entity entity, auto&&...) {
+				if (!contains(entity) && matches_without<Component>(entity)) {
+					insert(entity);
+				}
+			});
+		}
+
+		template <typename Component>
+		void disconnect(ComponentPool<Component>* pool) {
+			auto& connections = std::get<Connections<Component>>(m_connections);
+			pool->added_event().disconnect(connections.added);
+			pool->removed_event().disconnect(connections.removed);
+		}
+
+		bool matches(Entity entity) const {
+			return (std::get<ComponentPool<Included>*>(m_included)->contains(entity) && ...)
+					&& !(std::get<ComponentPool<Excluded>*>(m_excluded)->contains(entity) || ...);
+		}
+
+		// Matches while ignoring the excluded component IgnoredComponent
+		template <typename IgnoredComponent>
+		bool matches_without(Entity entity) const {
+			return (std::get<ComponentPool<Included>*>(m_included)->contains(entity) && ...)
+					&& !((!std::is_same_v<Excluded, IgnoredComponent>
+					&& std::get<ComponentPool<Excluded>*>(m_excluded)->contains(entity)) || ...);
+		}
+
+		void insert(Entity entity) {
+			const auto index = get_index(entity);
+
+			if (index >= m_sparse.size()) {
+				m_sparse.resize(index + 1, INVALID_DENSE_INDEX);
+			}
+
+			m_sparse[index] = static_cast<uint32_t>(m_dense.size());
+			m_dense.push_back(entity);
+		}
+
+		void erase(Entity entity) {
+			if (!contains(entity)) {
+				return;
+			}
+
+			const auto denseIndex = m_sparse[get_index(entity)];
+			const Entity last = m_dense.back();
+
+			m_dense[denseIndex] = last;
+			m_sparse[get_index(last)] = denseIndex;
+
+			m_dense.pop_back();
+			m_sparse[get_index(entity)] = INVALID_DENSE_INDEX;
+		}
+};
+
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory>
 #include <vector>
 
 #include <ecs/ecs_fwd.hpp>
@@ -8,11 +9,19 @@ namespace ECS {
 
 class SparseSet {
 	public:
+		// Number of entries per sparse page, must be a power of 2
+		static constexpr size_t PAGE_SIZE = 1024;
+		// Emptied pages kept allocated for reuse before further emptied pages are released
+		static constexpr size_t MAX_RETAINED_EMPTY_PAGES = 4;
+
 		virtual ~SparseSet() = default;
 
 		void insert(Entity);
 		virtual void remove(Entity);
 		virtual void clear();
+		// Empties the set without touching its entities: sparse pages are kept and invalidated by
+		// bumping the epoch, and no removals are logged
+		void clear_by_epoch();
 
 		bool contains(Entity) const;
 		bool contains_before_index(Entity, size_t indexEnd) const;
@@ -20,27 +29,23 @@ class SparseSet {
 		bool empty() const;
 		size_t size() const;
 
+		// Moves every entity satisfying cond to the front of the dense array in a single pass,
+		// returning the number of entities that matched
 		template <typename Condition>
-		size_t swap_back_all(Condition&& cond) {
+		size_t partition(Condition&& cond) {
+			size_t numMatched = 0;
+
 			for (size_t i = 0; i < m_dense.size(); ++i) {
-				if (!cond(m_dense[i])) {
-					bool noneLeft = true;
-
-					for (size_t j = i + 1; j < m_dense.size(); ++j) {
-						if (cond(m_dense[j])) {
-							swap(i, j);
-							noneLeft = false;
-							break;
-						}
+				if (cond(m_dense[i])) {
+					if (i != numMatched) {
+						swap(i, numMatched);
 					}
 
-					if (noneLeft) {
-						return i;
-					}
+					++numMatched;
 				}
 			}
 
-			return m_dense.size();
+			return numMatched;
 		}
 
 		void swap_to_match(const SparseSet&, size_t numToSwap);
@@ -53,9 +58,84 @@ class SparseSet {
 		virtual uint64_t get_type_id() const = 0;
 
 		size_t get_sparse_index(Entity) const;
+
+		size_t get_num_pages() const;
+		// Bytes allocated for the sparse pages, the dense array and the change ticks
+		size_t get_memory_usage() const;
+
+		// Change tracking. Inserting an entity stamps its added and changed ticks with the current
+		// tick, mark_changed restamps the changed tick. Iteration and lookups never stamp, writers
+		// mark the components they modify.
+		struct Removal {
+			Entity entity;
+			uint32_t tick;
+		};
+
+		// Removals older than this many ticks are dropped from the removal log
+		static constexpr uint32_t REMOVAL_HISTORY_TICKS = 16;
+
+		void mark_changed(Entity);
+
+		void mark_changed_by_index(size_t index) {
+			m_changedTicks[index] = m_currentTick;
+		}
+
+		bool added_since(Entity, uint32_t sinceTick) const;
+		bool changed_since(Entity, uint32_t sinceTick) const;
+
+		bool added_since_by_index(size_t index, uint32_t sinceTick) const {
+			return is_tick_newer(m_addedTicks[index], sinceTick);
+		}
+
+		bool changed_since_by_index(size_t index, uint32_t sinceTick) const {
+			return is_tick_newer(m_changedTicks[index], sinceTick);
+		}
+
+		void set_current_tick(uint32_t);
+		uint32_t get_current_tick() const;
+
+		// Entities removed from the pool in the last REMOVAL_HISTORY_TICKS ticks, oldest first.
+		// Nothing is logged until a consumer enables the log.
+		const std::vector<Removal>& get_removals() const;
+		void enable_removal_log();
+
+		// Position of the pool in the owning Manager's pool list, which is the pool's bit in
+		// entity component signatures
+		uint32_t get_pool_index() const;
+		void set_pool_index(uint32_t);
 	private:
-		std::vector<Entity> m_sparse;
+		// Pages are allocated on the first insert into their index range. Once the last entity in
+		// that range is removed the page is kept for reuse, unless MAX_RETAINED_EMPTY_PAGES empty
+		// pages are kept already. clear() keeps every page by bumping the epoch: a page stamped
+		// with an older epoch is treated as empty and refilled on the next insert into it.
+		// Entries hold dense indices, which fit the index bits of an entity whatever its width.
+		struct Page {
+			std::unique_ptr<EntityIndex_T[]> entries;
+			size_t count;
+			uint32_t epoch;
+		};
+
+		std::vector<Page> m_sparse;
+		uint32_t m_epoch = 0;
+		// Allocated pages of the current epoch without entities
+		size_t m_numEmptyPages = 0;
 		std::vector<Entity> m_dense;
+		uint32_t m_poolIndex = 0;
+		// Parallel to m_dense
+		std::vector<uint32_t> m_addedTicks;
+		std::vector<uint32_t> m_changedTicks;
+		std::vector<Removal> m_removals;
+		bool m_logRemovals = false;
+		uint32_t m_currentTick = 0;
+
+		static constexpr EntityIndex_T INVALID_DENSE_INDEX = ~EntityIndex_T{0};
+
+		EntityIndex_T& get_or_create_sparse_entry(Entity);
+		void log_removal(Entity);
+		void prune_removals();
+		EntityIndex_T& get_sparse_entry(Entity);
+		const EntityIndex_T& get_sparse_entry(Entity) const;
+		void release_sparse_entry(Entity);
 };
 
 }
@@ -0,0 +1,92 @@
+#include "system_scheduler.hpp"
+
+#include <algorithm>
+
+#include <core/job_system.hpp>
+
+using namespace ECS;
+
+// SystemAccess
+
+SystemAccess& SystemAccess::exclusive() {
+	m_exclusive = true;
+	return *this;
+}
+
+static bool has_any_of(const std::vector<uint64_t>& typeIDs, const std::vector<uint64_t>& others) {
+	for (auto typeID : typeIDs) {
+		if (std::find(others.begin(), others.end(), typeID) != others.end()) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool SystemAccess::conflicts_with(const SystemAccess& other) const {
+	return m_exclusive || other.m_exclusive
+			|| has_any_of(m_writes, other.m_writes)
+			|| has_any_of(m_writes, other.m_reads)
+			|| has_any_of(m_reads, other.m_writes);
+}
+
+// SystemScheduler
+
+void SystemScheduler::add_system(std::string_view name, SystemAccess access,
+		SystemFunction func) {
+	m_systems.push_back({std::string(name), std::move(access), std::move(func)});
+	m_needsRebuild = true;
+}
+
+void SystemScheduler::run(float deltaTime) {
+	if (m_needsRebuild) {
+		rebuild_stages();
+	}
+
+	for (auto& stage : m_stages) {
+		if (stage.size() == 1 || !g_jobSystem) {
+			for (auto systemIndex : stage) {
+				m_systems[systemIndex].function(deltaTime);
+			}
+
+			continue;
+		}
+
+		JobSystem::Counter counter;
+
+		for (size_t i = 1; i < stage.size(); ++i) {
+			g_jobSystem->run(counter, [this, deltaTime, systemIndex = stage[i]] {
+				m_systems[systemIndex].function(deltaTime);
+			});
+		}
+
+		m_systems[stage[0]].function(deltaTime);
+		g_jobSystem->wait(counter);
+	}
+}
+
+// A system is placed in the stage after the last stage containing a system it conflicts with
+void SystemScheduler::rebuild_stages() {
+	m_needsRebuild = false;
+	m_stages.clear();
+
+	std::vector<uint32_t> systemStages(m_systems.size());
+
+	for (uint32_t i = 0; i < static_cast<uint32_t>(m_systems.size()); ++i) {
+		uint32_t stage = 0;
+
+		for (uint32_t j = 0; j < i; ++j) {
+			if (m_systems[i].access.conflicts_with(m_systems[j].access)) {
+				stage = std::max(stage, systemStages[j] + 1);
+			}
+		}
+
+		systemStages[i] = stage;
+
+		if (m_stages.size() <= stage) {
+			m_stages.resize(stage + 1);
+		}
+
+		m_stages[stage].push_back(i);
+	}
+}
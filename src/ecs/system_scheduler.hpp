@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <ecs/type_id_generator.hpp>
+
+namespace ECS {
+
+// Declares which types a system reads and writes. Any type may be used, so shared resources such as
+// renderers can be declared alongside components. Systems that add or remove components or create
+// entities change the pool layout and must be declared exclusive.
+class SystemAccess {
+	public:
+		template <typename... Types>
+		SystemAccess& reads() {
+			(m_reads.push_back(TypeIDGenerator::get_type_id<Types>()), ...);
+			return *this;
+		}
+
+		template <typename... Types>
+		SystemAccess& writes() {
+			(m_writes.push_back(TypeIDGenerator::get_type_id<Types>()), ...);
+			return *this;
+		}
+
+		SystemAccess& exclusive();
+
+		bool conflicts_with(const SystemAccess&) const;
+	private:
+		std::vector<uint64_t> m_reads;
+		std::vector<uint64_t> m_writes;
+		bool m_exclusive = false;
+};
+
+// Runs systems in the order they were added. A system only waits for earlier systems whose access
+// conflicts with its own, systems that do not conflict run at the same time on g_jobSystem.
+class SystemScheduler {
+	public:
+		using SystemFunction = std::function<void(float)>;
+
+		void add_system(std::string_view name, SystemAccess access, SystemFunction func);
+
+		void run(float deltaTime);
+	private:
+		struct System {
+			std::string name;
+			SystemAccess access;
+			SystemFunction function;
+		};
+
+		std::vector<System> m_systems;
+		// Each stage holds systems that do not conflict with each other, stages run in order
+		std::vector<std::vector<uint32_t>> m_stages;
+		bool m_needsRebuild = false;
+
+		void rebuild_stages();
+};
+
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+
+#include <algorithm>
+#include <bit>
+#include <vector>
+
+#include <ecs/ecs_fwd.hpp>
+
+namespace ECS {
+
+// One bit per entity index. Each word is stamped with the epoch it was last written in and words
+// from older epochs read as zero, so clear() only bumps the epoch.
+class TagBitset {
+	public:
+		bool test(Entity entity) const {
+			const auto index = get_index(entity);
+			const auto word = index / 64;
+
+			return word < m_words.size() && m_words[word].epoch == m_epoch
+					&& (m_words[word].bits >> (index % 64)) & 1;
+		}
+
+		void set(Entity entity) {
+			const auto index = get_index(entity);
+			get_live_word(index / 64) |= uint64_t{1} << (index % 64);
+		}
+
+		void reset(Entity entity) {
+			const auto index = get_index(entity);
+			get_live_word(index / 64) &= ~(uint64_t{1} << (index % 64));
+		}
+
+		void clear() {
+			if (++m_epoch == 0) {
+				std::fill(m_words.begin(), m_words.end(), Word{});
+			}
+		}
+
+		// Calls func(index) for every set entity index in increasing order, skipping 64 indices
+		// per empty word
+		template <typename Functor>
+		void for_each_index(Functor&& func) const {
+			for (size_t word = 0; word < m_words.size(); ++word) {
+				if (m_words[word].epoch != m_epoch) {
+					continue;
+				}
+
+				for (auto bits = m_words[word].bits; bits != 0; bits &= bits - 1) {
+					func(static_cast<EntityIndex_T>(word * 64 + std::countr_zero(bits)));
+				}
+			}
+		}
+	private:
+		struct Word {
+			uint64_t bits;
+			uint32_t epoch;
+		};
+
+		std::vector<Word> m_words;
+		uint32_t m_epoch = 0;
+
+		uint64_t& get_live_word(size_t word) {
+			if (word >= m_words.size()) {
+				m_words.resize(word + 1);
+			}
+
+			auto& w = m_words[word];
+
+			if (w.epoch != m_epoch) {
+				w.bits = 0;
+				w.epoch = m_epoch;
+			}
+
+			return w.bits;
+		}
+};
+
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+
+#include <memory>
+#include <vector>
+
+#include <ecs/sparse_set.hpp>
+
+namespace ECS {
+
+// Open addressing table of Tag<Value> pools keyed by Value. Tag values are string hashes which may
+// also be looked up at runtime, so they are kept out of the dense type indexed pool table.
+class TagPoolTable {
+	public:
+		SparseSet* find(uint64_t tagValue) const;
+		// Returns the slot for tagValue, which holds null if the pool has not been created yet.
+		// The reference is invalidated by the next call.
+		std::unique_ptr<SparseSet>& get_or_insert(uint64_t tagValue);
+	private:
+		struct Slot {
+			uint64_t tagValue;
+			std::unique_ptr<SparseSet> pool;
+		};
+
+		// Power of 2 sized, a slot is empty when its pool is null
+		std::vector<Slot> m_slots;
+		size_t m_size = 0;
+
+		size_t find_slot(uint64_t tagValue) const;
+		void grow();
+};
+
+}
@@ -1,12 +1,71 @@
 #pragma once
 
+#include <cassert>
+
 #include <algorithm>
+#include <array>
 #include <tuple>
 
+#include <core/job_system.hpp>
+
 #include <ecs/component_pool.hpp>
 
 namespace ECS {
 
+// Default number of dense entries handed to each job by par_for_each
+constexpr size_t DEFAULT_PARALLEL_CHUNK_SIZE = 1024;
+
+// Restricts iteration to entities whose components were added or changed after a given tick
+class TickFilters {
+	public:
+		static constexpr size_t MAX_FILTERS = 4;
+
+		void add(const SparseSet& pool, uint32_t sinceTick, bool addedOnly) {
+			assert(m_numFilters < MAX_FILTERS);
+			m_filters[m_numFilters++] = {&pool, sinceTick, addedOnly};
+		}
+
+		bool empty() const {
+			return m_numFilters == 0;
+		}
+
+		bool accepts(Entity entity) const {
+			for (size_t i = 0; i < m_numFilters; ++i) {
+				auto& filter = m_filters[i];
+
+				if (filter.addedOnly ? !filter.pool->added_since(entity, filter.sinceTick)
+						: !filter.pool->changed_since(entity, filter.sinceTick)) {
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		// Only valid when index is the entity's dense index in every filtered pool
+		bool accepts_index(size_t index) const {
+			for (size_t i = 0; i < m_numFilters; ++i) {
+				auto& filter = m_filters[i];
+
+				if (filter.addedOnly ? !filter.pool->added_since_by_index(index, filter.sinceTick)
+						: !filter.pool->changed_since_by_index(index, filter.sinceTick)) {
+					return false;
+				}
+			}
+
+			return true;
+		}
+	private:
+		struct Filter {
+			const SparseSet* pool;
+			uint32_t sinceTick;
+			bool addedOnly;
+		};
+
+		std::array<Filter, MAX_FILTERS> m_filters;
+		size_t m_numFilters = 0;
+};
+
 template <typename... Components>
 class View {
 	public:
@@ -15,6 +74,23 @@ class View {
 					[](const auto* a, const auto* b) { return a->size() < b->size(); }))
 				, m_pools(&pools...) {}
 
+		// Only visit entities whose Component was changed (or added) after sinceTick. for_each does
+		// not stamp, writers call Manager::mark_changed for what they modify
+		template <typename Component>
+		View changed(uint32_t sinceTick) const {
+			View result = *this;
+			result.m_filters.add(*std::get<ComponentPool<Component>*>(m_pools), sinceTick, false);
+			return result;
+		}
+
+		// Only visit entities whose Component was added after sinceTick
+		template <typename Component>
+		View added(uint32_t sinceTick) const {
+			View result = *this;
+			result.m_filters.add(*std::get<ComponentPool<Component>*>(m_pools), sinceTick, true);
+			return result;
+		}
+
 		template <typename Functor>
 		void for_each(Functor&& func) {
 			for (auto entity : m_smallestPool->get_dense()) {
@@ -37,12 +113,36 @@ class View {
 				}
 			}
 		}
+
+		// Like for_each, but splits the smallest pool into chunks that run on g_jobSystem. func
+		// must be safe to call concurrently for different entities.
+		template <typename Functor>
+		void par_for_each(Functor&& func, size_t chunkSize = DEFAULT_PARALLEL_CHUNK_SIZE) {
+			if (!g_jobSystem) {
+				for_each(std::forward<Functor>(func));
+				return;
+			}
+
+			auto* entities = m_smallestPool->get_dense().data();
+
+			g_jobSystem->parallel_for(m_smallestPool->size(), chunkSize, [&](size_t begin,
+					size_t end) {
+				for (size_t i = begin; i < end; ++i) {
+					if (has_all_components(entities[i])) {
+						func(entities[i],
+								std::get<ComponentPool<Components>*>(m_pools)->get(entities[i])...);
+					}
+				}
+			});
+		}
 	private:
 		const SparseSet* m_smallestPool;
 		std::tuple<ComponentPool<Components>*...> m_pools;
+		TickFilters m_filters;
 
 		bool has_all_components(Entity entity) {
-			return (std::get<ComponentPool<Components>*>(m_pools)->contains(entity) && ...);
+			return (std::get<ComponentPool<Components>*>(m_pools)->contains(entity) && ...)
+					&& (m_filters.empty() || m_filters.accepts(entity));
 		}
 };
 
@@ -52,33 +152,75 @@ class View<Component> {
 		explicit View(ComponentPool<Component>& pool)
 				: m_pool(&pool) {}
 
+		template <typename FilterComponent>
+		View changed(uint32_t sinceTick) const {
+			static_assert(std::is_same_v<FilterComponent, Component>);
+
+			View result = *this;
+			result.m_filters.add(*m_pool, sinceTick, false);
+			return result;
+		}
+
+		template <typename FilterComponent>
+		View added(uint32_t sinceTick) const {
+			static_assert(std::is_same_v<FilterComponent, Component>);
+
+			View result = *this;
+			result.m_filters.add(*m_pool, sinceTick, true);
+			return result;
+		}
+
+		// Components are accessed by dense index, which also covers paged pools
 		template <typename Functor>
 		void for_each(Functor&& func) {
-			auto* components = m_pool->get_components();
-			auto componentCount = m_pool->get_component_count();
+			auto componentCount = m_pool->size();
 			auto& entities = m_pool->get_dense();
 
 			for (size_t i = 0; i < componentCount; ++i) {
-				func(entities[i], components[i]);
+				if (m_filters.empty() || m_filters.accepts_index(i)) {
+					func(entities[i], m_pool->get_by_index(i));
+				}
 			}
 		}
 
 		template <typename Functor>
 		void for_each_cond(Functor&& func) {
-			auto* components = m_pool->get_components();
-			auto componentCount = m_pool->get_component_count();
+			auto componentCount = m_pool->size();
 			auto& entities = m_pool->get_dense();
 
 			for (size_t i = 0; i < componentCount; ++i) {
-				if (auto res = func(entities[i], components[i]);
+				if (!m_filters.empty() && !m_filters.accepts_index(i)) {
+					continue;
+				}
+
+				if (auto res = func(entities[i], m_pool->get_by_index(i));
 						res == IterationDecision::BREAK) {
 					return;
 				}
 			}
 		}
+
+		template <typename Functor>
+		void par_for_each(Functor&& func, size_t chunkSize = DEFAULT_PARALLEL_CHUNK_SIZE) {
+			if (!g_jobSystem) {
+				for_each(std::forward<Functor>(func));
+				return;
+			}
+
+			auto* entities = m_pool->get_dense().data();
+
+			g_jobSystem->parallel_for(m_pool->size(), chunkSize, [&](size_t begin,
+					size_t end) {
+				for (size_t i = begin; i < end; ++i) {
+					if (m_filters.empty() || m_filters.accepts_index(i)) {
+						func(entities[i], m_pool->get_by_index(i));
+					}
+				}
+			});
+		}
 	private:
 		ComponentPool<Component>* m_pool;
+		TickFilters m_filters;
 };
 
 }
-
@@ -59,7 +59,7 @@ static void RecursiveInit(ECS::Entity eInstance, int aDepth = 0)
 static void RecursiveDraw(ECS::Entity eScreenGui, ECS::Entity eTreeview, ECS::Entity eInstance, size_t aDepth, int& aPosition)
 {
 	Instance* aInstance = &g_ecs->get_component<Instance>(eInstance);
-	if (aInstance->m_name.compare("CoreEditorGui") == 0)
+	if (aInstance->m_name.get_string().compare("CoreEditorGui") == 0)
 	{
 		return;
 	}
@@ -76,7 +76,7 @@ static void RecursiveDraw(ECS::Entity eScreenGui, ECS::Entity eTreeview, ECS::En
 			}
 		}
 
-		std::string finalName = sub + aInstance->m_name;// std::string{ aInstance->m_name };
+		std::string finalName = sub + aInstance->m_name.get_string();// std::string{ aInstance->m_name };
 		treeviewEntry.m_label = CreateTextLabel({
 			.Text{finalName.data()},
 			.Font{Game::FontID::MSGOTHIC},
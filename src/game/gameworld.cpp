@@ -32,23 +32,26 @@ ECS::Entity LoadAndInitializeMesh(const char* meshPath, const char* modelName, c
 	auto eImportedRig = instWorkspace->find_first_child(*g_ecs, "ImportedRig");
 	auto& instImportedRig = g_ecs->get_component<Game::Instance>(eImportedRig);
 	
+	// The rig was just loaded, rebuild the hierarchy cache so each texture only visits the
+	// mesh parts
+	g_ecs->get_context<HierarchyCache>().update(*g_ecs);
+
 	for (auto& [name, path] : textureMap)
 	{
 		g_textureCache->get_or_load<TextureLoader>(name, *g_renderContext, path, false, true);
-		for_each_descendant(*g_ecs, instImportedRig, [&](auto entity, auto& desc) {
-			if (desc.m_classID == Game::InstanceClass::MESH_GEOM) {
-				auto& mp = g_ecs->get_component<Game::MeshGeom>(entity);
-				//mp.set_size(entity, Math::Vector3(10, 10, 10));
-
-				if (desc.m_name.compare(name) == 0)
-				{
-					mp.set_texture(entity, name);
-				}
+		for_each_descendant_of_class(*g_ecs, instImportedRig, Game::InstanceClass::MESH_GEOM,
+				[&](auto entity, auto& desc) {
+			auto& mp = g_ecs->get_component<Game::MeshGeom>(entity);
+			//mp.set_size(entity, Math::Vector3(10, 10, 10));
+
+			if (desc.m_name.get_string().compare(name) == 0)
+			{
+				mp.set_texture(entity, name);
 			}
 		});
 	}
 	
-	instImportedRig.m_name = modelName;
+	instImportedRig.set_name(*g_ecs, eImportedRig, modelName);
 	return eImportedRig;
 }
 
@@ -75,10 +78,15 @@ void Gameworld::init()
 			auto& instance = g_ecs->get_component<Instance>(eSU47E);
 			model.set_primary_geom_transform(*g_ecs, instance, Math::Transform(0, 5, 0) * Math::Transform::from_axis_angle({ 1, 0, 0 }, Math::radians<float>(90)));
 		}
-		eSU47E = LoadAndInitializeMesh("res://TSF/SU47E/Craft/Body.glb", "SU47E", { {"su47E", "res://TSF/SU47E/Craft/Chara_tsf_30000_su47e_body_color.png"} });
+		// The second copy shares the meshes, rig and textures of the first
+		auto eWorkspace = ECS::INVALID_ENTITY;
+		g_game->get_singleton(InstanceClass::GAMEWORLD, eWorkspace);
+		auto eSU47ECopy = ECS::INVALID_ENTITY;
+		InstanceFactory::instantiate(*g_ecs, eSU47E, eSU47ECopy)->set_parent(*g_ecs, eWorkspace,
+				eSU47ECopy);
 		{
-			auto& model = g_ecs->get_component<Model>(eSU47E);
-			auto& instance = g_ecs->get_component<Instance>(eSU47E);
+			auto& model = g_ecs->get_component<Model>(eSU47ECopy);
+			auto& instance = g_ecs->get_component<Instance>(eSU47ECopy);
 			model.set_primary_geom_transform(*g_ecs, instance, Math::Transform(25, 5, 0) * Math::Transform::from_axis_angle({ 1, 0, 0 }, Math::radians<float>(90)));
 		}
 		auto eSU37 = LoadAndInitializeMesh("res://TSF/SU37/Craft/Body.glb", "SU37", { {"su37", "res://TSF/SU37/Craft/Chara_tsf_033001_su37m2_body_color.png"} });
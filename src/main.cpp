@@ -24,14 +24,20 @@
 #include <core/hashed_string.hpp>
 #include <core/logging.hpp>
 
+#include <core/job_system.hpp>
+
 #include <ecs/ecs.hpp>
+#include <ecs/system_scheduler.hpp>
 
 #include <file/file_system.hpp>
 
 #include <core/components.hpp>
 #include <core/context_action.hpp>
 #include <rendering/renderer/game_renderer.hpp>
+#include <rendering/renderer/rigged_mesh_renderer.hpp>
+#include <core/hierarchy_cache.hpp>
 #include <core/instance_utils.hpp>
+#include <core/ancestry_change_queue.hpp>
 #include <core/ancestry_changed_callbacks.hpp>
 #include <core/destroyed_callbacks.hpp>
 #include <asset/rigged_mesh_loader.hpp>
@@ -68,6 +74,9 @@ bool EDITOR_DEBUG = false;
 
 using namespace Game;
 
+// Number of entities processed per frame for groups created with get_group_deferred()
+static constexpr size_t DEFERRED_GROUP_BUILD_BUDGET = 4096;
+
 int main(int argc, char** argv) {
 	std::string_view gameFilePath = "Z:\\Archive\\somefile.something";
 
@@ -97,6 +106,7 @@ int main(int argc, char** argv) {
 	g_fontFamilyCache.create();
 	g_animationCache.create();
 
+	g_jobSystem.create();
 	g_ecs.create();
 
 	g_contextActionManager.create();
@@ -243,6 +253,28 @@ int main(int argc, char** argv) {
 		}
 	});
 
+	// Systems whose declared access does not conflict run at the same time. The UI adds and
+	// removes tag components every frame, so it runs on its own.
+	ECS::SystemScheduler systems;
+	systems.add_system("UI", ECS::SystemAccess().exclusive(), [](float deltaTime) {
+		Game::update_ui(*g_ecs, deltaTime);
+	});
+	systems.add_system("Animators", ECS::SystemAccess()
+			.reads<Instance, Model, Geometry, MeshGeom>()
+			.writes<Animator, BoneAttachment>(), [](float deltaTime) {
+		Game::update_animators(*g_ecs, deltaTime);
+	});
+	systems.add_system("Rigs", ECS::SystemAccess()
+			.reads<Instance, Model, BoneAttachment>()
+			.writes<RigComponent, RiggedMeshRenderer>(), [](float) {
+		Game::update_rigs(*g_ecs);
+	});
+	systems.add_system("Gameworld", ECS::SystemAccess()
+			.reads<Camera>()
+			.writes<GameRenderer>(), [&](float deltaTime) {
+		gameworld.update(deltaTime);
+	});
+
 //	Game::ProfilerFrontend::init();
 #ifdef _DEBUG
 	Game::EditorFrontend::init();
@@ -260,11 +292,19 @@ int main(int argc, char** argv) {
 #ifdef _DEBUG
 		Game::EditorFrontend::update();
 #endif
-		Game::update_ui(*g_ecs, deltaTime);
-		Game::update_animators(*g_ecs, deltaTime);
-		Game::update_rigs(*g_ecs);
+		g_ecs->advance_tick();
+		g_ecs->update_deferred_groups(DEFERRED_GROUP_BUILD_BUDGET);
+		// Ancestry callbacks may reparent instances, so they are flushed first. Systems share the
+		// hierarchy cache read only, so it is rebuilt before they run.
+		g_ecs->get_context<Game::AncestryChangeQueue>().flush(*g_ecs);
+		g_ecs->get_context<Game::HierarchyCache>().update(*g_ecs);
+
+		systems.run(deltaTime);
+
+		// World transforms of bones set by the animators are propagated once, parents first
+		Game::BoneAttachment::update_world_transforms(*g_ecs);
+		Game::Attachment::update_world_transforms(*g_ecs);
 
-		gameworld.update(deltaTime);
 		if (EDITOR_DEBUG)
 		{
 #ifdef _DEBUG
@@ -296,6 +336,7 @@ int main(int argc, char** argv) {
 	Game::ProfilerFrontend::deinit();
 
 	g_ecs.destroy();
+	g_jobSystem.destroy();
 
 	g_renderer.destroy();
 
@@ -55,6 +55,9 @@ project "Engine"
         "editor/**.h",
         "editor/**.cpp",
         "editor/**.hpp",
+        "benchmark/**.h",
+        "benchmark/**.cpp",
+        "benchmark/**.hpp",
     }
 
     includedirs {
@@ -219,6 +222,68 @@ project "Editor"
             "SYSTEM_WINDOWS"
         }
     
+-- Standalone ECS micro-benchmarks, only needs the ECS and job system sources. ECSBenchmark64 is
+-- built with 64 bit entities to compare the two widths.
+function ecs_benchmark_project(name, extra_defines)
+    project(name)
+        location "%{wks.location}/src/"
+        kind "ConsoleApp"
+        language "C++"
+        cppdialect "C++20"
+
+        targetdir("../bin/")
+        debugdir("../bin/")
+        targetname("%{prj.name}_%{cfg.buildcfg}")
+        objdir("../temp/%{prj.name}/%{cfg.buildcfg}")
+
+        defines(extra_defines)
+
+        files {
+            "benchmark/**.h",
+            "benchmark/**.hpp",
+            "benchmark/**.cpp",
+            "core/job_system.cpp",
+            "core/logging.cpp",
+            "ecs/archetype_storage.cpp",
+            "ecs/ecs.cpp",
+        }
+
+        includedirs {
+            ".",
+        }
+
+        filter "configurations:Debug"
+            defines {"_DEBUG", "%{wks.name}_DEBUG"}
+            runtime "Debug"
+            symbols "on"
+        filter "configurations:Release"
+            defines {"_RELEASE", "%{wks.name}_RELEASE"}
+            runtime "Release"
+            optimize "on"
+        filter "configurations:Retail"
+            defines {"_RETAIL", "%{wks.name}_RETAIL"}
+            runtime "Release"
+            optimize "on"
+
+        filter "system:windows"
+            symbols "on"
+            systemversion "latest"
+            flags {
+                "MultiProcessorCompile"
+            }
+
+            defines {
+                "WIN32",
+                "_CRT_SECURE_NO_WARNINGS",
+                "SYSTEM_WINDOWS"
+            }
+
+        filter {}
+end
+
+ecs_benchmark_project("ECSBenchmark", {})
+ecs_benchmark_project("ECSBenchmark64", {"USE_64_BIT_ENTITIES"})
+
 print("Found Vulkan SDK: "..vulkan_sdk)
 project "Game"
     location "%{wks.location}/src/"
@@ -46,6 +46,20 @@ class BufferComponentPool : public SparseSet {
 			m_addedEvent.fire(entity, m_components.back());
 		}
 
+		// Adds count entities, moving their values out of components, and notifies the added
+		// listeners once for the whole batch
+		void emplace_range(const Entity* entities, Component* components, size_t count) {
+			const size_t first = m_components.size();
+			m_components.reserve(first + count);
+
+			for (size_t i = 0; i < count; ++i) {
+				insert(entities[i]);
+				m_components.emplace_back(std::move(components[i]));
+			}
+
+			m_addedEvent.fire_range(count, entities, m_components.data() + first);
+		}
+
 		void find_and_swap_to(Entity entity, size_t destIndex) {
 			const auto srcIndex = get_sparse_index(entity);
 			swap(srcIndex, destIndex);
@@ -63,13 +77,7 @@ class BufferComponentPool : public SparseSet {
 		}
 
 		virtual void clear() override {
-			if (!m_removedEvent.empty()) {
-				auto& dense = get_dense();
-
-				for (size_t i = 0, l = dense.size(); i < l; ++i) {
-					m_removedEvent.fire(dense[i], m_components[i]);
-				}
-			}
+			m_removedEvent.fire_range(size(), get_dense().data(), m_components.data());
 
 			SparseSet::clear();
 			m_components.clear();
@@ -26,7 +26,8 @@ UIRenderer::UIRenderer(TextBitmap& textBitmap, VkRenderPass renderPass, uint32_t
 	init_images();
 	init_descriptors();
 
-	g_ecs->get_group<Game::RectInstance, Game::RectInstanceInfo>();
+	// Built over the next frames by Manager::update_deferred_groups
+	g_ecs->get_group_deferred<Game::RectInstance, Game::RectInstanceInfo>();
 }
 
 /*void UIRenderer::sort() {
@@ -319,7 +320,13 @@ void UIRenderer::fetch_rect_updates() {
 	// FIXME: frame allocator
 	std::vector<size_t> updates;
 	// FIXME: Tag rect updates
-	auto& group = g_ecs->get_group<Game::RectInstance, Game::RectInstanceInfo>();
+	auto& group = g_ecs->get_group_deferred<Game::RectInstance, Game::RectInstanceInfo>();
+
+	// Sorting swaps within the group, tagged rects stay pending until it is built
+	if (!group.is_built()) {
+		return;
+	}
+
 	auto& infoPool = g_ecs->get_pool<Game::RectInstanceInfo>();
 	const auto* rectInfoData = infoPool.get_components();
 	//const auto* dense = infoPool.get_dense().data();
@@ -6,6 +6,7 @@
 #include <core/logging.hpp>
 #include <core/hashed_string.hpp>
 
+#include <ecs/command_buffer.hpp>
 #include <ecs/ecs.hpp>
 
 #include <core/data_model.hpp>
@@ -193,8 +194,12 @@ static void draw_children(ECS::Manager& ecs, const Math::Transform2D& parentTran
 	}
 }
 
+// Mouse tags are recorded while iterating the GUI pools and added in one batch afterwards
+static ECS::CommandBuffer g_mouseCommands;
+
 template <typename GuiClass>
-static void update_mouse_occupancy(ECS::Manager& ecs, const Math::Vector2& mousePos, const Math::Vector2& invScreen) {
+static void update_mouse_occupancy(ECS::Manager& ecs, ECS::CommandBuffer& commands,
+		const Math::Vector2& mousePos, const Math::Vector2& invScreen) {
 	ecs.run_system<GuiClass>([&](auto entity, auto& uiObj) {
 		bool mouseInside = uiObj.contains_point(mousePos, invScreen);
 		bool lastMouseInside = uiObj.is_mouse_inside();
@@ -202,14 +207,14 @@ static void update_mouse_occupancy(ECS::Manager& ecs, const Math::Vector2& mouse
 		uiObj.set_mouse_inside(mouseInside);
 
 		if (mouseInside) {
-			ecs.add_component<ECS::Tag<"MouseInside"_hs>>(entity);
+			commands.add_component<ECS::Tag<"MouseInside"_hs>>(entity);
 		}
 
 		if (!lastMouseInside && mouseInside) {
-			ecs.add_component<ECS::Tag<"MouseEnter"_hs>>(entity);
+			commands.add_component<ECS::Tag<"MouseEnter"_hs>>(entity);
 		}
 		else if (lastMouseInside && !mouseInside) {
-			ecs.add_component<ECS::Tag<"MouseLeave"_hs>>(entity);
+			commands.add_component<ECS::Tag<"MouseLeave"_hs>>(entity);
 		}
 	});
 }
@@ -260,15 +265,17 @@ static void update_ui_input(ECS::Manager& ecs, const Math::Vector2& screenSize,
 	ecs.clear_pool<ECS::Tag<"MouseLeave"_hs>>();
 	ecs.clear_pool<ECS::Tag<"MouseInside"_hs>>();
 
-	update_mouse_occupancy<Rect2D>(ecs, mousePos, invScreen);
-	update_mouse_occupancy<TextRect>(ecs, mousePos, invScreen);
-	update_mouse_occupancy<InputRect>(ecs, mousePos, invScreen);
-	update_mouse_occupancy<TextButton>(ecs, mousePos, invScreen);
-	update_mouse_occupancy<ImageRect>(ecs, mousePos, invScreen);
-	update_mouse_occupancy<ImageButton>(ecs, mousePos, invScreen);
-	update_mouse_occupancy<ScrollingRect>(ecs, mousePos, invScreen);
-	update_mouse_occupancy<ResizableRect>(ecs, mousePos, invScreen);
-	update_mouse_occupancy<VideoRect>(ecs, mousePos, invScreen);
+	update_mouse_occupancy<Rect2D>(ecs, g_mouseCommands, mousePos, invScreen);
+	update_mouse_occupancy<TextRect>(ecs, g_mouseCommands, mousePos, invScreen);
+	update_mouse_occupancy<InputRect>(ecs, g_mouseCommands, mousePos, invScreen);
+	update_mouse_occupancy<TextButton>(ecs, g_mouseCommands, mousePos, invScreen);
+	update_mouse_occupancy<ImageRect>(ecs, g_mouseCommands, mousePos, invScreen);
+	update_mouse_occupancy<ImageButton>(ecs, g_mouseCommands, mousePos, invScreen);
+	update_mouse_occupancy<ScrollingRect>(ecs, g_mouseCommands, mousePos, invScreen);
+	update_mouse_occupancy<ResizableRect>(ecs, g_mouseCommands, mousePos, invScreen);
+	update_mouse_occupancy<VideoRect>(ecs, g_mouseCommands, mousePos, invScreen);
+
+	g_mouseCommands.apply(ecs);
 
 	update_auto_button_color(ecs);
 	update_dynamic_rects(ecs, g_application->get_mouse_position(), mousePos, deltaTime);
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <ecs/component_sort.hpp>
+
 #include <rendering/buffer_component_pool.hpp>
 
 #include <math/vector2.hpp>
@@ -77,3 +79,15 @@ struct RectInstanceInfo {
 
 }
 
+namespace ECS {
+
+template <>
+struct RadixSortKey<Game::RectInstanceInfo> {
+	static constexpr bool ENABLED = true;
+
+	static RadixKey128 get(const Game::RectInstanceInfo& info) {
+		return {info.priority.highOrder, info.priority.lowOrder};
+	}
+};
+
+}